@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+// the binary adjacency file of metrics_ooc.cpp and cn_pairs_ooc.cpp (data/adj_bin/<name>.adj):
+//     header: magic, n, m, size and mtime of the edge file it was built from, k (long long)
+//     block bounds: the k + 1 vertex bounds of the blocks used to build it (long long)
+//     offsets[n + 1] (long long), then the sorted neighbor lists (int)
+// the neighbor lists do not depend on the blocks, so a file built with another budget is still valid;
+// it is written to "<file>.tmp" and renamed once complete, so an interrupted build is never reused
+const long long adj_bin_magic = 0x316e6962206a6461LL;  // "adj bin1"
+const int adj_bin_header_size = 6;
+
+// reads "u v" (an optional weight column is skipped)
+inline bool read_edge(std::ifstream &fin, int &u, int &v) {
+    if (!(fin >> u >> v)) return false;
+    fin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    return true;
+}
+
+inline long long intersection_size(const int *a, int len_a, const int *b, int len_b) {
+    long long res = 0;
+    int i = 0, j = 0;
+    while (i < len_a && j < len_b) {
+        if (a[i] < b[j]) ++i;
+        else if (a[i] > b[j]) ++j;
+        else ++res, ++i, ++j;
+    }
+    return res;
+}
+
+// what the header records of the edge file
+inline void adj_bin_source(const std::string &edge_input, long long &size, long long &mtime) {
+    size = (long long)std::filesystem::file_size(edge_input);
+    mtime = (long long)std::filesystem::last_write_time(edge_input).time_since_epoch().count();
+}
+
+// whether adj_file exists and was built from the current edge file: same n, m, source size and mtime, and offsets
+inline bool adj_bin_valid(const std::string &edge_input, const std::string &adj_file, int n, int m,
+                          const std::vector<long long> &offsets) {
+    std::ifstream fadj(adj_file.c_str(), std::ios::binary);
+    long long header[adj_bin_header_size];
+    if (!fadj.read((char *)header, sizeof(header))) return false;
+    long long size, mtime;
+    adj_bin_source(edge_input, size, mtime);
+    if (header[0] != adj_bin_magic || header[1] != n || header[2] != m || header[3] != size || header[4] != mtime ||
+        header[5] <= 0 || header[5] > n) {
+        return false;
+    }
+    long long k = header[5];
+    fadj.seekg(sizeof(header) + sizeof(long long) * (k + 1));
+    // the offsets are compared piece by piece, to keep no second copy resident
+    std::vector<long long> buf(1 << 16);
+    for (long long x = 0; x <= n; x += (long long)buf.size()) {
+        long long len = std::min((long long)buf.size(), n + 1 - x);
+        if (!fadj.read((char *)buf.data(), sizeof(long long) * len)) return false;
+        if (!std::equal(buf.begin(), buf.begin() + len, offsets.begin() + x)) return false;
+    }
+    fadj.seekg(0, std::ios::end);
+    long long expected = (long long)(sizeof(header) + sizeof(long long) * (k + 1 + n + 1) + sizeof(int) * offsets[n]);
+    return (long long)fadj.tellg() == expected;
+}
+
+// built with one pass per vertex block over the edge file, so only one block is ever resident;
+// deg serves as the fill counters of the block (and is restored), so the build needs no memory beyond the block
+// assumes the edge file lists each undirected edge once, without self-loops (as written in 0-preprocessing)
+inline void build_adj_bin(const std::string &edge_input, const std::string &adj_file, int n, int m,
+                          std::vector<int> &deg, const std::vector<long long> &offsets,
+                          const std::vector<std::pair<int, int>> &blocks) {
+    std::string tmp_file = adj_file + ".tmp";
+    std::ofstream fout(tmp_file.c_str(), std::ios::binary);
+    long long header[adj_bin_header_size] = {adj_bin_magic, n, m, 0, 0, (long long)blocks.size()};
+    adj_bin_source(edge_input, header[3], header[4]);
+    fout.write((const char *)header, sizeof(header));
+    for (auto &b : blocks) {
+        long long lo = b.first;
+        fout.write((const char *)&lo, sizeof(lo));
+    }
+    long long end = n;
+    fout.write((const char *)&end, sizeof(end));
+    fout.write((const char *)offsets.data(), sizeof(long long) * (n + 1));
+    long long base = (long long)sizeof(header) + sizeof(long long) * (blocks.size() + 1 + n + 1);
+    for (auto &[lo, hi] : blocks) {
+        std::vector<int> buf(offsets[hi] - offsets[lo]);
+        std::ifstream fin(edge_input.c_str());
+        int u, v;
+        for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+            if (lo <= u && u < hi) buf[offsets[u] - offsets[lo] + --deg[u]] = v;
+            if (lo <= v && v < hi) buf[offsets[v] - offsets[lo] + --deg[v]] = u;
+        }
+        fin.close();
+        for (int x = lo; x < hi; ++x) {
+            deg[x] = (int)(offsets[x + 1] - offsets[x]);
+            std::sort(buf.begin() + (offsets[x] - offsets[lo]), buf.begin() + (offsets[x + 1] - offsets[lo]));
+        }
+        fout.seekp(base + sizeof(int) * offsets[lo]);
+        fout.write((const char *)buf.data(), sizeof(int) * buf.size());
+    }
+    fout.close();
+    std::filesystem::rename(tmp_file, adj_file);
+}
+
+// the position of the neighbor lists in the file
+inline long long adj_bin_base(std::ifstream &fadj, int n) {
+    long long header[adj_bin_header_size];
+    fadj.seekg(0);
+    fadj.read((char *)header, sizeof(header));
+    return (long long)sizeof(header) + sizeof(long long) * (header[5] + 1 + n + 1);
+}
+
+// one resident vertex block [lo, hi) of the adjacency file
+struct AdjBlock {
+    int id = -1, lo = 0, hi = 0;
+    std::vector<int> nbrs;
+
+    const int *begin(const std::vector<long long> &offsets, int x) const { return nbrs.data() + (offsets[x] - offsets[lo]); }
+};
+
+inline void load_block(std::ifstream &fadj, long long base, const std::vector<long long> &offsets,
+                       const std::vector<std::pair<int, int>> &blocks, int b, AdjBlock &blk) {
+    if (blk.id == b) return;
+    blk.id = b;
+    blk.lo = blocks[b].first;
+    blk.hi = blocks[b].second;
+    blk.nbrs.resize(offsets[blk.hi] - offsets[blk.lo]);
+    fadj.seekg(base + sizeof(int) * offsets[blk.lo]);
+    fadj.read((char *)blk.nbrs.data(), sizeof(int) * blk.nbrs.size());
+}
+
+// releases the memory of a block
+inline void unload_block(AdjBlock &blk) {
+    blk.id = -1;
+    std::vector<int>().swap(blk.nbrs);
+}
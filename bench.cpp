@@ -0,0 +1,515 @@
+#include <math.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "compressed_adj.h"
+#include "edge_betweenness.h"
+#include "edge_kernels.h"
+#include "edge_metrics.h"
+#include "perf_profile.h"
+
+using namespace std;
+mutex mut_m, mut_n;
+
+// benchmarks of the kernels of cn_pairs.cpp, metrics.cpp, local_path.cpp and eb.cpp on synthetic graphs
+// with the (n, m) of a dataset (scaled by --scale), so no external data is needed
+// the CN, FM and LP kernels (std::set and "--compressed" neighbor lists) and the heavy-edge split are those of
+// edge_kernels.h, the end-to-end metrics run the schedule of edge_metrics.h and the edge betweenness the routine
+// of edge_betweenness.h, as the programs do
+// Chung-Lu uses the degree sequence of the dataset when its edge file is available (scale = 1), and otherwise a
+// power law with the exponent fitted on that sequence (2.5 without it), unless --gamma is given
+// usage: ./bench <dataset> [--gen chung-lu|rmat] [--scale s] [--gamma g] [--seed x] [--samples k]
+//                          [--save-baseline] [--tolerance t]
+// the results are compared with bench_baseline/<dataset>_<gen>_<scale>.txt ("kernel items/s peak MB" per line)
+// if it exists, and the exit code is 1 if any throughput drops, or any peak memory grows, by more than the
+// tolerance (default 0.1)
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+static double seconds_since(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// peak resident memory (MB) since the last reset_peak_memory()
+static double peak_memory_mb() {
+    ifstream fin("/proc/self/status");
+    string line;
+    while (getline(fin, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return atof(line.c_str() + 6) / 1024.;
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.;
+}
+
+// resets the peak to the current resident memory (Linux only, otherwise the peak is process-wide)
+static void reset_peak_memory() {
+    ofstream fout("/proc/self/clear_refs");
+    fout << "5";
+}
+
+// m distinct edges without self-loops; draw() returns a candidate (u, v)
+static void sample_edges(int n, long long m, function<pair<int, int>()> draw, vector<int> &uu, vector<int> &vv) {
+    unordered_set<long long> seen;
+    seen.reserve(m * 2);
+    long long attempts = 0;
+    while ((long long)uu.size() < m) {
+        if (++attempts > 100 * m) {
+            throw runtime_error("too many duplicate edges, the graph is too dense for the generator");
+        }
+        auto [u, v] = draw();
+        if (u == v) continue;
+        if (u > v) swap(u, v);
+        if (!seen.insert((long long)u * n + v).second) continue;
+        uu.push_back(u);
+        vv.push_back(v);
+    }
+}
+
+// Chung-Lu: P(u) proportional to the expected degree w_u, with w_u ~ (u + 1)^(-1 / (gamma - 1)) (power law with exponent gamma),
+// or the given degree sequence
+static void chung_lu(int n, long long m, double gamma, const vector<int> &degrees, mt19937_64 &rng,
+                     vector<int> &uu, vector<int> &vv) {
+    vector<double> w(n);
+    for (int x = 0; x < n; ++x) {
+        w[x] = degrees.empty() ? pow(x + 1., -1. / (gamma - 1.)) : (double)degrees[x];
+    }
+    discrete_distribution<int> pick(w.begin(), w.end());
+    sample_edges(n, m, [&]() { return make_pair(pick(rng), pick(rng)); }, uu, vv);
+}
+
+// R-MAT with (a, b, c, d) = (0.57, 0.19, 0.19, 0.05); ids outside [0, n) are redrawn,
+// and the ids are shuffled so that the hubs are not all at the small ids
+static void rmat(int n, long long m, mt19937_64 &rng, vector<int> &uu, vector<int> &vv) {
+    int levels = 1;
+    while ((1LL << levels) < n) ++levels;
+    vector<int> perm(n);
+    iota(perm.begin(), perm.end(), 0);
+    shuffle(perm.begin(), perm.end(), rng);
+    uniform_real_distribution<double> unif(0., 1.);
+    auto draw = [&]() {
+        while (true) {
+            long long u = 0, v = 0;
+            for (int l = 0; l < levels; ++l) {
+                double r = unif(rng);
+                int bu = r >= 0.57 + 0.19, bv = (r >= 0.57 && r < 0.57 + 0.19) || r >= 0.57 + 0.19 + 0.19;
+                u = (u << 1) | bu;
+                v = (v << 1) | bv;
+            }
+            if (u < n && v < n) return make_pair(perm[u], perm[v]);
+        }
+    };
+    sample_edges(n, m, draw, uu, vv);
+}
+
+// the power-law exponent of a degree sequence (Clauset, Shalizi and Newman): the discrete maximum-likelihood
+// estimate 1 + k / sum(ln(d / (d_min - 1/2))) over the k degrees d >= d_min, with d_min the candidate (about
+// 25% apart) whose tail is the closest to the fitted law in Kolmogorov-Smirnov distance; 0 without a tail of 50
+static double fit_gamma(vector<int> degrees) {
+    sort(degrees.begin(), degrees.end());
+    degrees.erase(degrees.begin(), upper_bound(degrees.begin(), degrees.end(), 0));
+    double gamma = 0., best_ks = 1.;
+    for (int d_min = 1; !degrees.empty() && d_min <= degrees.back(); d_min = max(d_min + 1, (int)(d_min * 1.25))) {
+        auto first = lower_bound(degrees.begin(), degrees.end(), d_min);
+        long long k = degrees.end() - first;
+        if (k < 50) break;
+        double log_sum = 0.;
+        for (auto it = first; it != degrees.end(); ++it) log_sum += log(*it / (d_min - 0.5));
+        double alpha = 1. + k / log_sum;
+        // the largest gap between P(D >= d) of the tail and ((d - 1/2) / (d_min - 1/2))^(1 - alpha)
+        double ks = 0.;
+        for (auto it = first; it != degrees.end(); it = upper_bound(it, degrees.end(), *it)) {
+            double empirical = (double)(degrees.end() - it) / k;
+            double model = pow((*it - 0.5) / (d_min - 0.5), 1. - alpha);
+            ks = max(ks, fabs(empirical - model));
+        }
+        if (ks < best_ks) best_ks = ks, gamma = alpha;
+    }
+    return gamma;
+}
+
+struct Result {
+    string name;
+    double items, seconds, peak_mb;
+};
+
+int main(int argc, char *argv[]) {
+    string dataset(argv[1]);
+    string gen = "chung-lu";
+    double scale = 1., gamma = 0., tolerance = 0.1;
+    long long seed = 0, samples = 100000;
+    bool save_baseline = false, profile = false;
+    for (int a = 2; a < argc; ++a) {
+        string arg(argv[a]);
+        if (arg == "--gen" && a + 1 < argc) gen = argv[++a];
+        else if (arg == "--scale" && a + 1 < argc) scale = atof(argv[++a]);
+        else if (arg == "--gamma" && a + 1 < argc) gamma = atof(argv[++a]);
+        else if (arg == "--seed" && a + 1 < argc) seed = atoll(argv[++a]);
+        else if (arg == "--samples" && a + 1 < argc) samples = atoll(argv[++a]);
+        else if (arg == "--tolerance" && a + 1 < argc) tolerance = atof(argv[++a]);
+        else if (arg == "--save-baseline") save_baseline = true;
+        else if (arg == "--profile") profile = true;
+        else throw invalid_argument("unknown option " + arg);
+    }
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument( "unknown dataset");
+    }
+    // the degree sequence of the real graph, when its edge file is available: used as is by Chung-Lu at scale 1,
+    // and otherwise for the exponent of its power law
+    vector<int> degrees;
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    if (gen == "chung-lu" && std::filesystem::exists(edge_input)) {
+        degrees.assign(n, 0);
+        ifstream fin(edge_input.c_str());
+        int u, v;
+        string line;
+        while (getline(fin, line)) {
+            istringstream(line) >> u >> v;
+            ++degrees[u];
+            ++degrees[v];
+        }
+        fin.close();
+    }
+    if (gamma == 0. && !degrees.empty()) gamma = fit_gamma(degrees);
+    if (gamma == 0.) gamma = 2.5;
+    if (scale != 1.) degrees.clear();
+    n = max(2, (int)(n * scale));
+    m = (int)min((long long)(m * scale), (long long)n * (n - 1) / 2);
+
+    // with --profile, the counters of each kernel (a phase named as the kernel) go to data/profile/<dataset>_bench.json
+    Profiler prof(profile);
+    prof.phase("generate");
+    auto t0 = chrono::steady_clock::now();
+    mt19937_64 rng(seed);
+    vector<int> uu, vv;
+    uu.reserve(m);
+    vv.reserve(m);
+    if (gen == "chung-lu") chung_lu(n, m, gamma, degrees, rng, uu, vv);
+    else if (gen == "rmat") rmat(n, m, rng, uu, vv);
+    else throw invalid_argument("unknown generator");
+    prof.phase("adjacency build");
+    vector<set<int>> v2Nv(n);
+    for (auto i = 0; i < m; ++i) {
+        v2Nv[uu[i]].insert(vv[i]);
+        v2Nv[vv[i]].insert(uu[i]);
+    }
+    CompressedAdj adj(n, uu, vv);
+    int d_max = 0;
+    for (auto &N : v2Nv) d_max = max(d_max, (int)N.size());
+    string law = gen != "chung-lu" ? "" : degrees.empty() ? " (gamma = " + to_string(gamma) + ")" : " (real degrees)";
+    cout << dataset << " " << gen << law << ": n = " << n << ", m = " << m
+         << ", d_max = " << d_max << ", generated in " << seconds_since(t0) << " s" << endl;
+
+    // the edges (and the sources) used by the microbenchmarks
+    vector<int> sample(m);
+    iota(sample.begin(), sample.end(), 0);
+    shuffle(sample.begin(), sample.end(), rng);
+    sample.resize(min((long long)m, samples));
+    vector<Result> results;
+    volatile double sink = 0.;
+
+    // CN intersection (cn_pairs.cpp, metrics.cpp), FM (metrics.cpp) and LP (local_path.cpp) per sampled edge,
+    // with both neighbor lists; each kernel is a phase, and its peak memory is that of the resident graph
+    double total = 0.;
+    auto run_kernel = [&](const string &name, function<double(int u, int v)> kernel) {
+        prof.phase(name);
+        reset_peak_memory();
+        t0 = chrono::steady_clock::now();
+        total = 0.;
+        for (auto i : sample) total += kernel(uu[i], vv[i]);
+        sink = sink + total;
+        results.push_back({name, (double)sample.size(), seconds_since(t0), peak_memory_mb()});
+    };
+    double epsilon = 0.001;
+    run_kernel("intersection", [&](int u, int v) { return (double)count_common(v2Nv, u, v); });
+    run_kernel("intersection_c", [&](int u, int v) { return (double)count_common(adj, u, v); });
+    run_kernel("fm", [&](int u, int v) { return (double)count_fm(v2Nv, u, v, 0, (int)v2Nv[u].size()); });
+    run_kernel("fm_c", [&](int u, int v) { return (double)count_fm(adj, u, v, 0, adj.degree(u)); });
+    run_kernel("lp", [&](int u, int v) {
+        return 1. + (double)count_common(v2Nv, u, v) + (double)count_paths(v2Nv, u, v, 0, (int)v2Nv[u].size()) * epsilon;
+    });
+    run_kernel("lp_c", [&](int u, int v) {
+        return 1. + (double)count_common(adj, u, v) + (double)count_paths(adj, u, v, 0, adj.degree(u)) * epsilon;
+    });
+
+    // the heavy-edge split of metrics.cpp and local_path.cpp: the FM of the costliest edges (d_u * d_v),
+    // cut by slice_edges into one dynamic pool, the most expensive first
+    prof.phase("heavy_fm");
+    reset_peak_memory();
+    t0 = chrono::steady_clock::now();
+    auto degree = [&](int x) { return (int)v2Nv[x].size(); };
+    vector<int> heavy(m);
+    iota(heavy.begin(), heavy.end(), 0);
+    auto edge_cost = [&](int i) { return (double)degree(uu[i]) * (double)degree(vv[i]); };
+    int n_heavy = (int)min((long long)m, 64LL);
+    partial_sort(heavy.begin(), heavy.begin() + n_heavy, heavy.end(),
+                 [&](int i, int j) { return edge_cost(i) > edge_cost(j); });
+    heavy.resize(n_heavy);
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    auto slices = slice_edges(heavy, uu, vv, degree, nb_threads_hint == 0 ? 8 : (int)nb_threads_hint);
+    vector<long long> slice_fm(slices.size(), 0);
+    parallel_for_dynamic(slices.size(), [&](int k) {
+        Profiler::thread_enter();
+        slice_fm[k] = count_fm(v2Nv, slices[k].u, slices[k].v, slices[k].start, slices[k].end);
+    });
+    sink = sink + (double)accumulate(slice_fm.begin(), slice_fm.end(), 0LL);
+    results.push_back({"heavy_fm", (double)n_heavy, seconds_since(t0), peak_memory_mb()});
+
+    // wedges u - x - y (y > u) from the sampled sources, counted per y: the CNs of u with every other node
+    prof.phase("wedge");
+    reset_peak_memory();
+    t0 = chrono::steady_clock::now();
+    vector<int> cnt(n, 0);
+    double wedges = 0.;
+    for (auto i : sample) {
+        int s = uu[i];
+        for (auto x : v2Nv[s]) {
+            for (auto y : v2Nv[x]) {
+                if (y > s) ++cnt[y], wedges += 1.;
+            }
+        }
+        for (auto x : v2Nv[s]) {
+            for (auto y : v2Nv[x]) cnt[y] = 0;
+        }
+    }
+    sink = sink + wedges;
+    results.push_back({"wedge", wedges, seconds_since(t0), peak_memory_mb()});
+
+    // end to end: the edge betweenness of eb.cpp (all sources, O(n m)), only when affordable
+    if ((double)n * m <= 2e9) {
+        prof.phase("e2e_eb");
+        reset_peak_memory();
+        t0 = chrono::steady_clock::now();
+        vector<Edge> edge_array;
+        edge_array.reserve(m);
+        for (auto i = 0; i < m; ++i) edge_array.emplace_back(uu[i], vv[i]);
+        Graph_type g = make_graph(edge_array, n);
+        ECMap ecm = edge_betweenness(g);
+        for (auto &[edge, centrality] : ecm) sink = sink + centrality;
+        results.push_back({"e2e_eb", (double)n * m, seconds_since(t0), peak_memory_mb()});
+    }
+
+    // end to end: all the per-edge metrics of metrics.cpp over every edge, with its schedule and all threads
+    prof.phase("e2e_metrics");
+    reset_peak_memory();
+    t0 = chrono::steady_clock::now();
+    vector<double> cn(m), sa(m), jc(m), hp(m), hd(m), si(m), li(m), aa(m), ra(m), pa(m), fm(m), dl(m);
+    {
+        vector<double> edge_cost = edge_costs(v2Nv, uu, vv);
+        vector<int> chunk_bounds = balanced_split(edge_cost, 1024);
+        vector<int> todo(chunk_bounds.size() - 1);
+        iota(todo.begin(), todo.end(), 0);
+        schedule_edge_metrics(v2Nv, uu, vv, edge_cost, 0, chunk_bounds, todo, [](int n_heavy) {},
+                              [&](int i, const EdgeMetrics &r) {
+            cn[i] = r.cn;
+            sa[i] = r.sa;
+            jc[i] = r.jc;
+            hp[i] = r.hp;
+            hd[i] = r.hd;
+            si[i] = r.si;
+            li[i] = r.li;
+            aa[i] = r.aa;
+            ra[i] = r.ra;
+            pa[i] = r.pa;
+            fm[i] = r.fm;
+            dl[i] = r.dl;
+        }, [](int chunk) {});
+    }
+    results.push_back({"e2e_metrics", (double)m, seconds_since(t0), peak_memory_mb()});
+
+    // end to end: the CN pair histogram of cn_pairs.cpp, only when the n^2 / 2 pairs are affordable
+    if (n <= 50000) {
+        prof.phase("e2e_cn_pairs");
+        reset_peak_memory();
+        t0 = chrono::steady_clock::now();
+        map<int, long long> cn2p;
+        parallel_for(n - 1, [&](int start, int end) {
+            Profiler::thread_enter();
+            map<int, long long> cn2p_local;
+            for (int i = start; i < end; ++i) {
+                for (int j = i + 1; j < n; ++j) {
+                    ++cn2p_local[(int)count_common(v2Nv, i, j)];
+                }
+            }
+            mut_m.lock();
+            for (auto const &x: cn2p_local) cn2p[x.first] += x.second;
+            mut_m.unlock();
+        });
+        results.push_back({"e2e_cn_pairs", (double)n * (n - 1) / 2, seconds_since(t0), peak_memory_mb()});
+    }
+
+    prof.finish();
+    if (profile) {
+        // the rates of the kernels, and the bytes of adjacency (std::set tree nodes) read per item
+        vector<pair<string, double>> derived = {{"adjacency_bytes", 2. * m * 40. + (double)n * sizeof(set<int>)}};
+        for (auto &r : results) {
+            derived.emplace_back(r.name + "_items_per_second", r.items / max(r.seconds, 1e-9));
+            double cache_misses = prof.counter(r.name, "cache_misses");
+            derived.emplace_back(r.name + "_cache_miss_bytes_per_item", cache_misses < 0 ? NAN : cache_misses * 64. / r.items);
+        }
+        std::filesystem::create_directories("data/profile");
+        prof.write_json("data/profile/" + dataset + "_bench.json", "bench", dataset, derived);
+    }
+
+    // report, and compare the throughputs with the stored baseline
+    std::filesystem::create_directories("bench_baseline");
+    ostringstream scale_str;
+    scale_str << scale;
+    string baseline_file = "bench_baseline/" + dataset + "_" + gen + "_" + scale_str.str() + ".txt";
+    // kernel -> (items/s, peak MB); the peak is 0 (not compared) in a baseline saved without it
+    map<string, pair<double, double>> baseline;
+    {
+        ifstream fin(baseline_file.c_str());
+        string line;
+        while (getline(fin, line)) {
+            istringstream iss(line);
+            string name;
+            double rate, peak = 0.;
+            if (!(iss >> name >> rate)) continue;
+            iss >> peak;
+            baseline[name] = {rate, peak};
+        }
+    }
+    bool regression = false;
+    printf("%-14s %14s %10s %14s %10s %10s %10s\n", "kernel", "items", "seconds", "items/s", "peak MB", "vs base",
+           "peak vs");
+    for (auto &r : results) {
+        double rate = r.items / max(r.seconds, 1e-9);
+        string versus = "-", peak_versus = "-";
+        if (baseline.count(r.name)) {
+            auto [base_rate, base_peak] = baseline[r.name];
+            double ratio = rate / base_rate;
+            versus = to_string(ratio).substr(0, 5);
+            if (ratio < 1. - tolerance) {
+                regression = true;
+                versus += " !";
+            }
+            if (base_peak > 0 && r.peak_mb > 0) {
+                double peak_ratio = r.peak_mb / base_peak;
+                peak_versus = to_string(peak_ratio).substr(0, 5);
+                if (peak_ratio > 1. + tolerance) {
+                    regression = true;
+                    peak_versus += " !";
+                }
+            }
+        }
+        string peak = r.peak_mb > 0 ? to_string(r.peak_mb).substr(0, 8) : "-";
+        printf("%-14s %14.0f %10.3f %14.1f %10s %10s %10s\n", r.name.c_str(), r.items, r.seconds, rate, peak.c_str(),
+               versus.c_str(), peak_versus.c_str());
+    }
+    if (save_baseline) {
+        ofstream fout(baseline_file.c_str());
+        for (auto &r : results) {
+            fout << r.name << ' ' << r.items / max(r.seconds, 1e-9) << ' ' << r.peak_mb << endl;
+        }
+        fout.close();
+        cout << "baseline saved to " << baseline_file << endl;
+    }
+    return regression ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// the checkpoints of cn_pairs.cpp and metrics.cpp (data/checkpoint/<name>_<program>[.shard<i>of<N>].ckpt):
+// an append-only log of finished work chunks, so that an interrupted run can be resumed
+// the log starts with a key describing the run (magic, key length, then the key: size and mtime of the edge file,
+// n, m, the shard, the range of the shard and the chunk bounds), and a log whose key differs is not resumed;
+// a record is (chunk id, payload size, payload), and a record cut short by a kill, with an unknown chunk id or with
+// a payload size the program does not expect for the chunk ends the log (it is truncated there on load)
+// the compute threads only push records into the front buffer, and a background thread swaps the
+// two buffers every interval and writes the back one, so the compute threads never wait on the disk
+class Checkpointer {
+public:
+    static const long long magic = 0x31746e696f706b63LL;  // "ckpoint1"
+
+    // key: everything the chunks depend on, see checkpoint_key
+    Checkpointer(const std::string &file, std::vector<long long> key, int n_chunks, double interval)
+            : file(file), key(std::move(key)), n_chunks(n_chunks), interval(interval) {}
+
+    // the finished chunks of a previous run (chunk -> payload); the log is truncated after the last valid record
+    // valid_size(chunk, size): whether a payload of size bytes is what the chunk produces
+    std::map<int, std::vector<char>> load(std::function<bool(int, long long)> valid_size) {
+        std::map<int, std::vector<char>> chunk2payload;
+        std::ifstream fin(file.c_str(), std::ios::binary);
+        if (!fin.is_open()) return chunk2payload;
+        long long header[2] = {0, 0};
+        std::vector<long long> stored;
+        if (fin.read((char *)header, sizeof(header)) && header[0] == magic && header[1] == (long long)key.size()) {
+            stored.resize(key.size());
+            fin.read((char *)stored.data(), sizeof(long long) * stored.size());
+        }
+        if (!fin || stored != key) {
+            std::cout << file << " was written by another run (edge file, shard or chunks differ), starting over" << std::endl;
+            return chunk2payload;
+        }
+        long long valid_end = (long long)(sizeof(header) + sizeof(long long) * key.size());
+        int chunk;
+        long long size;
+        while (fin.read((char *)&chunk, sizeof(chunk)) && fin.read((char *)&size, sizeof(size))) {
+            if (chunk < 0 || chunk >= n_chunks || size < 0 || !valid_size(chunk, size)) break;
+            std::vector<char> payload(size);
+            if (!fin.read(payload.data(), size)) break;
+            chunk2payload[chunk] = std::move(payload);
+            valid_end += sizeof(chunk) + sizeof(size) + size;
+        }
+        fin.close();
+        std::filesystem::resize_file(file, valid_end);
+        resumed = true;
+        return chunk2payload;
+    }
+
+    void start() {
+        if (interval <= 0) return;
+        if (resumed) {
+            fout.open(file.c_str(), std::ios::binary | std::ios::app);
+        } else {
+            fout.open(file.c_str(), std::ios::binary | std::ios::trunc);
+            long long header[2] = {magic, (long long)key.size()};
+            fout.write((const char *)header, sizeof(header));
+            fout.write((const char *)key.data(), sizeof(long long) * key.size());
+            fout.flush();
+        }
+        writer = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(mut_buf);
+            while (!stopping) {
+                cv.wait_for(lock, std::chrono::duration<double>(interval), [this]() { return stopping; });
+                std::swap(front, back);
+                lock.unlock();
+                write_back();
+                lock.lock();
+            }
+        });
+    }
+
+    void add(int chunk, std::vector<char> payload) {
+        if (interval <= 0) return;
+        std::lock_guard<std::mutex> lock(mut_buf);
+        front.emplace_back(chunk, std::move(payload));
+    }
+
+    // writes the remaining records; the log is removed once the outputs are complete
+    void finish(bool remove_log) {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mut_buf);
+                stopping = true;
+            }
+            cv.notify_all();
+            writer.join();
+            std::swap(front, back);
+            write_back();
+            fout.close();
+        }
+        if (remove_log) std::filesystem::remove(file);
+    }
+
+private:
+    void write_back() {
+        for (auto &[chunk, payload] : back) {
+            long long size = (long long)payload.size();
+            fout.write((const char *)&chunk, sizeof(chunk));
+            fout.write((const char *)&size, sizeof(size));
+            fout.write(payload.data(), size);
+        }
+        fout.flush();
+        back.clear();
+    }
+
+    std::string file;
+    std::vector<long long> key;
+    int n_chunks;
+    double interval;
+    bool resumed = false, stopping = false;
+    std::ofstream fout;
+    std::thread writer;
+    std::mutex mut_buf;
+    std::condition_variable cv;
+    std::vector<std::pair<int, std::vector<char>>> front, back;
+};
+
+// the key of a run: the edge file (size and mtime), n, m, the shard, its range [lo, hi) and its chunk bounds
+inline std::vector<long long> checkpoint_key(const std::string &edge_input, int n, int m, int shard, int n_shards,
+                                             int lo, int hi, const std::vector<int> &chunk_bounds) {
+    std::vector<long long> key = {(long long)std::filesystem::file_size(edge_input),
+                                  (long long)std::filesystem::last_write_time(edge_input).time_since_epoch().count(),
+                                  n, m, shard, n_shards, lo, hi};
+    key.insert(key.end(), chunk_bounds.begin(), chunk_bounds.end());
+    return key;
+}
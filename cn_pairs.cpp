@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <bitset>
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <fstream>
@@ -18,6 +19,11 @@
 #include <vector>
 #include <mutex>
 
+#include "checkpoint.h"
+#include "compressed_adj.h"
+#include "edge_kernels.h"
+#include "perf_profile.h"
+
 
 using namespace std;
 mutex mut_m, mut_n;
@@ -71,9 +77,49 @@ void parallel_for(unsigned nb_elements,
 }
 
 
+// splits [0, costs.size()) into n_shards contiguous ranges of about equal total cost
+// the s-th range is [bounds[s], bounds[s + 1])
+static vector<int> balanced_split(const vector<double> &costs, int n_shards) {
+    vector<double> prefix(costs.size() + 1, 0.);
+    partial_sum(costs.begin(), costs.end(), prefix.begin() + 1);
+    vector<int> bounds(n_shards + 1, (int)costs.size());
+    bounds[0] = 0;
+    for (int s = 1; s < n_shards; ++s) {
+        double target = prefix.back() * s / n_shards;
+        bounds[s] = (int)(lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin());
+        bounds[s] = max(bounds[s], bounds[s - 1]);
+    }
+    return bounds;
+}
+
+
 int main(int argc, char *argv[]) {
     std::filesystem::create_directories("data/numberOfCN2numberOfPairs_cpp");
     string dataset(argv[1]);
+    // optional "--shard i/N": only the i-th (0-based) of N slices of the pairs, balanced by estimated cost
+    // optional "--resume": skip the chunks finished by a previous run, read from its checkpoint
+    // optional "--checkpoint-interval s": seconds between checkpoint writes (default 300, 0 disables)
+    // optional "--compressed": keep the neighbor lists delta + varint encoded (compressed_adj.h) instead of in sets
+    // optional "--profile": hardware counters per phase (perf_profile.h), reported to data/profile/<name>_cn_pairs.json
+    int shard = 0, n_shards = 1;
+    bool resume = false, compressed = false, profile = false;
+    double checkpoint_interval = 300.;
+    for (int a = 2; a < argc; ++a) {
+        if (string(argv[a]) == "--shard" && a + 1 < argc) {
+            sscanf(argv[++a], "%d/%d", &shard, &n_shards);
+        } else if (string(argv[a]) == "--resume") {
+            resume = true;
+        } else if (string(argv[a]) == "--checkpoint-interval" && a + 1 < argc) {
+            checkpoint_interval = atof(argv[++a]);
+        } else if (string(argv[a]) == "--compressed") {
+            compressed = true;
+        } else if (string(argv[a]) == "--profile") {
+            profile = true;
+        }
+    }
+    if (n_shards < 1 || shard < 0 || shard >= n_shards) {
+        throw invalid_argument("invalid shard");
+    }
     string dataset_full;
     int n, m;
     if (dataset == "OF") {
@@ -113,9 +159,11 @@ int main(int argc, char *argv[]) {
         throw invalid_argument("unknown dataset");
     }
 
+    Profiler prof(profile);
+    prof.phase("load");
     string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
     ifstream fin;
-    vector<set<int>> v2Nv(n);
+    vector<set<int>> v2Nv(compressed ? 0 : n);
     vector<int> uu, vv;
     uu.reserve(m);
     vv.reserve(m);
@@ -123,38 +171,119 @@ int main(int argc, char *argv[]) {
     int u, v;
     for (auto i = 0; i < m; ++i) {
         fin >> u >> v;
-        v2Nv[u].insert(v);
-        v2Nv[v].insert(u);
         uu.push_back(u);
         vv.push_back(v);
     }
     fin.close();
+    prof.phase("adjacency build");
+    if (!compressed) {
+        for (auto i = 0; i < m; ++i) {
+            v2Nv[uu[i]].insert(vv[i]);
+            v2Nv[vv[i]].insert(uu[i]);
+        }
+    }
+    CompressedAdj adj;
+    if (compressed) {
+        adj = CompressedAdj(n, uu, vv);
+        cout << "compressed adjacency: " << adj.bytes() << " bytes" << endl;
+    }
+    auto degree = [&](int x) { return compressed ? adj.degree(x) : (int)v2Nv[x].size(); };
+    prof.phase("kernel");
+    // the pairs (i, j > i) of row i cost about sum over j > i of (d_i + d_j + 1)
+    vector<double> row_cost(n - 1);
+    double deg_suffix = 0.;
+    for (int i = n - 2; i >= 0; --i) {
+        deg_suffix += (double)degree(i + 1);
+        row_cost[i] = (double)(n - 1 - i) * (degree(i) + 1) + deg_suffix;
+    }
+    vector<int> bounds = balanced_split(row_cost, n_shards);
+    int row_lo = bounds[shard], row_hi = bounds[shard + 1];
+    // the rows of the shard are processed (and checkpointed) in chunks of about equal cost
+    const int n_chunks = 1024;
+    vector<int> chunk_bounds = balanced_split(vector<double>(row_cost.begin() + row_lo, row_cost.begin() + row_hi), n_chunks);
+    string shard_name = n_shards > 1 ? ".shard" + to_string(shard) + "of" + to_string(n_shards) : "";
+    std::filesystem::create_directories("data/checkpoint");
+    Checkpointer ckpt("data/checkpoint/" + dataset_full + "_cn_pairs" + shard_name + ".ckpt",
+                      checkpoint_key(edge_input, n, m, shard, n_shards, row_lo, row_hi, chunk_bounds), n_chunks,
+                      checkpoint_interval);
     map<int, long long> cn2p;
+    vector<bool> chunk_done(n_chunks, false);
+    if (resume) {
+        // a chunk payload is its partial histogram, as (cn, count) pairs
+        auto valid_size = [](int, long long size) { return size % (long long)sizeof(pair<int, long long>) == 0; };
+        for (auto &[chunk, payload] : ckpt.load(valid_size)) {
+            chunk_done[chunk] = true;
+            auto *rec = (const pair<int, long long> *)payload.data();
+            for (size_t r = 0; r < payload.size() / sizeof(pair<int, long long>); ++r) {
+                cn2p[rec[r].first] += rec[r].second;
+            }
+        }
+    }
+    vector<int> todo;
+    for (int chunk = 0; chunk < n_chunks; ++chunk) {
+        if (!chunk_done[chunk]) todo.push_back(chunk);
+    }
+    ckpt.start();
     int node_count = 0;
-    parallel_for(n - 1, [&](int start, int end) {
-        for (int i = start; i < end; ++i) {
-            mut_n.lock();
-            cout << "\r" << node_count << "/" << (n - 1) << flush;
-            ++node_count;
-            mut_n.unlock();
-            for (int j = i + 1; j < n; ++j) {
-                vector<int> intersect;
-                set_intersection(v2Nv[i].begin(), v2Nv[i].end(), v2Nv[j].begin(), v2Nv[j].end(),
-                                 back_inserter(intersect));
-                int cn = (int) intersect.size();
-                mut_m.lock();
-                ++cn2p[cn];
-                mut_m.unlock();
+    parallel_for(todo.size(), [&](int start, int end) {
+        Profiler::thread_enter();
+        for (int t = start; t < end; ++t) {
+            int chunk = todo[t];
+            map<int, long long> cn2p_chunk;
+            for (int i = row_lo + chunk_bounds[chunk]; i < row_lo + chunk_bounds[chunk + 1]; ++i) {
+                mut_n.lock();
+                cout << "\r" << node_count << "/" << (row_hi - row_lo) << flush;
+                ++node_count;
+                mut_n.unlock();
+                for (int j = i + 1; j < n; ++j) {
+                    int cn = (int) (compressed ? count_common(adj, i, j) : count_common(v2Nv, i, j));
+                    ++cn2p_chunk[cn];
+                }
             }
+            vector<pair<int, long long>> rec(cn2p_chunk.begin(), cn2p_chunk.end());
+            ckpt.add(chunk, vector<char>((const char *)rec.data(), (const char *)(rec.data() + rec.size())));
+            mut_m.lock();
+            for (auto const &x: cn2p_chunk) cn2p[x.first] += x.second;
+            mut_m.unlock();
         }
     });
+    prof.phase("output");
     ofstream fout;
     string outfile = "data/numberOfCN2numberOfPairs_cpp/" + dataset_full + ".txt";
+    if (n_shards > 1) {
+        // partial histogram, combined by merge_shards
+        outfile = "data/numberOfCN2numberOfPairs_cpp/" + dataset_full + ".shard" + to_string(shard) + "of" + to_string(n_shards) + ".txt";
+    }
     fout.open(outfile.c_str());
     for (auto const &x: cn2p) {
         fout << x.first << ' ' << x.second << endl;
     }
     fout.close();
+    prof.finish();
+    if (profile) {
+        // a pair (i, j) reads about d_i + d_j neighbors for its intersection
+        double pairs = 0., entries = 0.;
+        for (auto chunk : todo) {
+            for (int i = row_lo + chunk_bounds[chunk]; i < row_lo + chunk_bounds[chunk + 1]; ++i) {
+                pairs += (double)(n - 1 - i);
+                entries += row_cost[i] - (double)(n - 1 - i);
+            }
+        }
+        // a std::set entry is a tree node (3 pointers, the color and the int)
+        double adjacency_bytes = compressed ? (double)adj.bytes() : 2. * m * 40. + (double)n * sizeof(set<int>);
+        double cache_misses = prof.counter("kernel", "cache_misses");
+        pairs = max(pairs, 1.);
+        std::filesystem::create_directories("data/profile");
+        prof.write_json("data/profile/" + dataset_full + "_cn_pairs" + shard_name + ".json", "cn_pairs", dataset, {
+            {"pairs", pairs},
+            {"pairs_per_second", pairs / prof.seconds("kernel")},
+            {"adjacency_bytes", adjacency_bytes},
+            {"adjacency_entries_per_pair", entries / pairs},
+            {"adjacency_bytes_per_pair", entries / pairs * adjacency_bytes / (2. * m)},
+            {"cache_miss_bytes_per_pair", cache_misses < 0 ? NAN : cache_misses * 64. / pairs},
+        });
+    }
+    ckpt.finish(true);
     return 0;
 }
 
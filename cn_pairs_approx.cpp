@@ -0,0 +1,267 @@
+#include <math.h>
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+
+
+using namespace std;
+mutex mut_m, mut_n;
+
+// estimates the histogram of cn_pairs.cpp (number of pairs sharing c CNs) by sampling, with confidence intervals
+// - c = 0: uniform node pairs, H(0) = P * k_0 / s, with P = n (n - 1) / 2 pairs
+// - c >= 1: uniform wedges x - a - b (a and b adjacent to x); a pair with c CNs is the endpoint pair of c of the W wedges,
+//   so H(c) = W / c * k_c / s, which covers the rare high-c pairs much better than uniform pairs
+// the intervals are Wilson score intervals of the sampled fractions, scaled by P or W / c
+// sampling stops when bucket 0 and every bucket holding at least --min-share of the wedge samples reach
+// the relative error --rel-error (half-width / estimate), or after --max-seconds
+// usage: ./cn_pairs_approx <dataset> [--rel-error e] [--z z] [--min-share f] [--max-seconds t] [--seed x]
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static
+void parallel_for(unsigned nb_elements,
+                  function<void(int start, int end)> functor,
+                  bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// reads "u v" (an optional weight column is skipped)
+static bool read_edge(ifstream &fin, int &u, int &v) {
+    if (!(fin >> u >> v)) return false;
+    fin.ignore(numeric_limits<streamsize>::max(), '\n');
+    return true;
+}
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// the r-th random number of sample t of a round, as counter_rng of pear_batch.cpp: the estimates depend only on
+// the seed, not on the number of threads or on which thread draws a sample
+static uint64_t counter_rng(uint64_t seed, uint64_t round, uint64_t t, uint64_t r) {
+    return mix(mix(mix(mix(seed) ^ round) ^ t) ^ r);
+}
+
+static double to_unit(uint64_t x) { return (double)(x >> 11) * 0x1.0p-53; }
+
+// uniform in [0, bound)
+static uint64_t to_range(uint64_t x, uint64_t bound) { return (uint64_t)(((unsigned __int128)x * bound) >> 64); }
+
+// Wilson score interval of the fraction k / s
+static pair<double, double> wilson(double k, double s, double z) {
+    double p = k / s;
+    double denom = 1. + z * z / s;
+    double center = (p + z * z / (2. * s)) / denom;
+    double half = z / denom * sqrt(p * (1. - p) / s + z * z / (4. * s * s));
+    return {max(0., center - half), min(1., center + half)};
+}
+
+
+int main(int argc, char *argv[]) {
+    std::filesystem::create_directories("data/numberOfCN2numberOfPairs_cpp");
+    string dataset(argv[1]);
+    double rel_error = 0.05, z = 1.96, min_share = 1e-3, max_seconds = 60.;
+    long long seed = 0;
+    for (int a = 2; a < argc; ++a) {
+        string arg(argv[a]);
+        if (arg == "--rel-error" && a + 1 < argc) rel_error = atof(argv[++a]);
+        else if (arg == "--z" && a + 1 < argc) z = atof(argv[++a]);
+        else if (arg == "--min-share" && a + 1 < argc) min_share = atof(argv[++a]);
+        else if (arg == "--max-seconds" && a + 1 < argc) max_seconds = atof(argv[++a]);
+        else if (arg == "--seed" && a + 1 < argc) seed = atoll(argv[++a]);
+        else throw invalid_argument("unknown option " + arg);
+    }
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument("unknown dataset");
+    }
+
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    ifstream fin;
+    vector<vector<int>> v2Nv(n);
+    fin.open(edge_input.c_str());
+    int u, v;
+    for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+        v2Nv[u].push_back(v);
+        v2Nv[v].push_back(u);
+    }
+    fin.close();
+    for (auto &N : v2Nv) sort(N.begin(), N.end());
+
+    // wedge centers are drawn with probability proportional to their d (d - 1) / 2 wedges, by a binary search
+    // of a uniform draw in [0, W) among the prefix sums (read only, so shared by the threads)
+    vector<double> wedges_prefix(n);
+    for (int x = 0; x < n; ++x) {
+        double d = (double)v2Nv[x].size();
+        wedges_prefix[x] = (x ? wedges_prefix[x - 1] : 0.) + d * (d - 1.) / 2.;
+    }
+    double W = n ? wedges_prefix.back() : 0.;
+    double P = (double)n * (n - 1) / 2.;
+    auto pick_center = [&](uint64_t x) {
+        double r = to_unit(x) * W;
+        auto it = upper_bound(wedges_prefix.begin(), wedges_prefix.end(), r);
+        return it == wedges_prefix.end() ? n - 1 : (int)(it - wedges_prefix.begin());
+    };
+    auto cn_of = [&](int a, int b) {
+        vector<int> intersect;
+        set_intersection(v2Nv[a].begin(), v2Nv[a].end(), v2Nv[b].begin(), v2Nv[b].end(), back_inserter(intersect));
+        return (int)intersect.size();
+    };
+
+    // k_pair[c]: uniform pairs with c CNs; k_wedge[c]: wedges whose endpoints share c CNs
+    map<int, long long> k_pair, k_wedge;
+    long long s_pair = 0, s_wedge = 0;
+    const int batch = 1 << 16;
+    auto t0 = chrono::steady_clock::now();
+    for (int round = 0;; ++round) {
+        parallel_for(batch, [&](int start, int end) {
+            map<int, long long> k_pair_local, k_wedge_local;
+            for (int t = start; t < end; ++t) {
+                // draws 0 and 1 pick the pair, draws 2, 3 and 4 the wedge
+                auto draw = [&](uint64_t r) { return counter_rng((uint64_t)seed, round, t, r); };
+                int i = (int)to_range(draw(0), n), j = (int)to_range(draw(1), n - 1);
+                if (j >= i) ++j;
+                ++k_pair_local[cn_of(i, j)];
+                if (W > 0) {
+                    auto &N_x = v2Nv[pick_center(draw(2))];
+                    int a = (int)to_range(draw(3), N_x.size()), b = (int)to_range(draw(4), N_x.size() - 1);
+                    if (b >= a) ++b;
+                    ++k_wedge_local[cn_of(N_x[a], N_x[b])];
+                }
+            }
+            mut_m.lock();
+            for (auto const &x: k_pair_local) k_pair[x.first] += x.second;
+            for (auto const &x: k_wedge_local) k_wedge[x.first] += x.second;
+            mut_m.unlock();
+        });
+        s_pair += batch;
+        if (W > 0) s_wedge += batch;
+
+        // the worst relative error among the buckets that must converge
+        auto [lo_0, hi_0] = wilson((double)k_pair[0], (double)s_pair, z);
+        double worst = k_pair[0] > 0 ? (hi_0 - lo_0) / 2. / ((double)k_pair[0] / s_pair) : 1.;
+        for (auto const &x: k_wedge) {
+            if (x.second < min_share * s_wedge) continue;
+            auto [lo, hi] = wilson((double)x.second, (double)s_wedge, z);
+            worst = max(worst, (hi - lo) / 2. / ((double)x.second / s_wedge));
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        mut_n.lock();
+        cout << "\r" << s_pair << " pairs, " << s_wedge << " wedges, relative error " << worst << "    " << flush;
+        mut_n.unlock();
+        if (worst <= rel_error || elapsed >= max_seconds) break;
+    }
+    cout << endl;
+
+    // c, estimate, lower and upper bound of the interval
+    ofstream fout;
+    string outfile = "data/numberOfCN2numberOfPairs_cpp/" + dataset_full + "_approx.txt";
+    fout.open(outfile.c_str());
+    auto [lo_0, hi_0] = wilson((double)k_pair[0], (double)s_pair, z);
+    fout << 0 << ' ' << P * k_pair[0] / s_pair << ' ' << P * lo_0 << ' ' << P * hi_0 << endl;
+    for (auto const &x: k_wedge) {
+        if (x.first == 0) continue;
+        double scale = W / x.first;
+        auto [lo, hi] = wilson((double)x.second, (double)s_wedge, z);
+        fout << x.first << ' ' << scale * x.second / s_wedge << ' ' << scale * lo << ' ' << scale * hi << endl;
+    }
+    fout.close();
+    return 0;
+}
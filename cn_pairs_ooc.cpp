@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+
+#include "adj_bin.h"
+
+using namespace std;
+mutex mut_m, mut_n;
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// usage: ./cn_pairs_ooc <dataset> <memory budget in MB>
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <dataset> <memory budget in MB>" << endl;
+        return 1;
+    }
+    std::filesystem::create_directories("data/numberOfCN2numberOfPairs_cpp");
+    std::filesystem::create_directories("data/adj_bin");
+    string dataset(argv[1]);
+    // memory budget in MB
+    long long budget = (long long)(atof(argv[2]) * (1 << 20));
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument("unknown dataset");
+    }
+
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    string adj_file = "data/adj_bin/" + dataset_full + ".adj";
+
+    // always resident, per node: the degree (4 bytes), the offset (8) and at most one block bound (8);
+    // plus the buffers of the open files
+    // the rest of the budget is split into two adjacency slots, one for each side of the pairs
+    long long resident = 20LL * (n + 1) + 2LL * BUFSIZ;
+    long long slot = (budget - resident) / 2;
+    if (slot <= 0) {
+        throw invalid_argument("memory budget too small");
+    }
+
+    vector<int> deg(n, 0);
+    ifstream fin;
+    fin.open(edge_input.c_str());
+    int u, v;
+    for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+        ++deg[u];
+        ++deg[v];
+    }
+    fin.close();
+    vector<long long> offsets(n + 1, 0);
+    for (int x = 0; x < n; ++x) offsets[x + 1] = offsets[x] + deg[x];
+
+    // contiguous vertex blocks whose neighbor lists fit in one slot
+    vector<pair<int, int>> blocks;
+    for (int lo = 0; lo < n;) {
+        int hi = lo + 1;
+        while (hi < n && (offsets[hi + 1] - offsets[lo]) * (long long)sizeof(int) <= slot) ++hi;
+        if ((offsets[hi] - offsets[lo]) * (long long)sizeof(int) > slot) {
+            throw invalid_argument("memory budget too small for the neighbor list of node " + to_string(lo));
+        }
+        blocks.emplace_back(lo, hi);
+        lo = hi;
+    }
+    int k = (int)blocks.size();
+    cout << k << " blocks" << endl;
+    if (!adj_bin_valid(edge_input, adj_file, n, m, offsets)) {
+        build_adj_bin(edge_input, adj_file, n, m, deg, offsets, blocks);
+    }
+
+    // pairs (i, j) with i < j, scheduled block pair by block pair so that two blocks are resident at a time
+    ifstream fadj(adj_file.c_str(), ios::binary);
+    long long base = adj_bin_base(fadj, n);
+    AdjBlock blk_i, blk_j;
+    map<int, long long> cn2p;
+    for (int bi = 0; bi < k; ++bi) {
+        load_block(fadj, base, offsets, blocks, bi, blk_i);
+        for (int bj = bi; bj < k; ++bj) {
+            mut_n.lock();
+            cout << "\r" << "block pair " << bi << "-" << bj << "/" << k << flush;
+            mut_n.unlock();
+            if (bj != bi) load_block(fadj, base, offsets, blocks, bj, blk_j);
+            const AdjBlock &blk_jj = bj == bi ? blk_i : blk_j;
+            int lo_i = blk_i.lo, hi_i = min(blk_i.hi, n - 1);
+            parallel_for(max(hi_i - lo_i, 0), [&](int start, int end) {
+                map<int, long long> cn2p_local;
+                for (int i = lo_i + start; i < lo_i + end; ++i) {
+                    const int *N_i = blk_i.begin(offsets, i);
+                    for (int j = max(i + 1, blk_jj.lo); j < blk_jj.hi; ++j) {
+                        const int *N_j = blk_jj.begin(offsets, j);
+                        ++cn2p_local[(int)intersection_size(N_i, deg[i], N_j, deg[j])];
+                    }
+                }
+                mut_m.lock();
+                for (auto const &x: cn2p_local) cn2p[x.first] += x.second;
+                mut_m.unlock();
+            });
+        }
+    }
+    cout << endl;
+    fadj.close();
+    ofstream fout;
+    string outfile = "data/numberOfCN2numberOfPairs_cpp/" + dataset_full + ".txt";
+    fout.open(outfile.c_str());
+    for (auto const &x: cn2p) {
+        fout << x.first << ' ' << x.second << endl;
+    }
+    fout.close();
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+// compressed neighbor lists, used by the "--compressed" mode of metrics.cpp, local_path.cpp and cn_pairs.cpp
+// each sorted list is cut into blocks of up to block_size neighbors; the first neighbor of a block is kept in
+// a skip index (block_first) and the others as byte-aligned varint deltas, so that a block can be decoded,
+// skipped or searched on its own, and the intersections only decode the blocks that overlap
+class CompressedAdj {
+public:
+    static const int block_size = 64;
+
+    CompressedAdj() {}
+
+    // from the edge list (each undirected edge once, without self-loops)
+    // the neighbor lists are gathered, sorted and encoded a range of vertices at a time, with at most about 1/16 of
+    // the 2m entries in the buffer (or a single vertex), so that no uncompressed copy of the adjacency is ever built
+    CompressedAdj(int n, const std::vector<int> &uu, const std::vector<int> &vv) : deg(n, 0), block_begin(n + 1, 0) {
+        for (size_t i = 0; i < uu.size(); ++i) {
+            ++deg[uu[i]];
+            ++deg[vv[i]];
+        }
+        long long n_blocks = 0;
+        for (int x = 0; x < n; ++x) n_blocks += (deg[x] + block_size - 1) / block_size;
+        block_first.reserve(n_blocks);
+        block_offset.reserve(n_blocks + 1);
+        block_offset.push_back(0);
+        long long batch = std::max(2LL * (long long)uu.size() / 16, 1LL << 16);
+        std::vector<int> buf;
+        std::vector<long long> cursor;
+        for (int lo = 0; lo < n;) {
+            int hi = lo;
+            long long len = 0;
+            while (hi < n && (hi == lo || len + deg[hi] <= batch)) len += deg[hi++];
+            buf.resize(len);
+            cursor.assign(hi - lo, 0);
+            for (int x = lo + 1; x < hi; ++x) cursor[x - lo] = cursor[x - lo - 1] + deg[x - 1];
+            for (size_t i = 0; i < uu.size(); ++i) {
+                if (lo <= uu[i] && uu[i] < hi) buf[cursor[uu[i] - lo]++] = vv[i];
+                if (lo <= vv[i] && vv[i] < hi) buf[cursor[vv[i] - lo]++] = uu[i];
+            }
+            // the cursors now point at the end of each list
+            for (int x = lo; x < hi; ++x) {
+                long long end = cursor[x - lo], begin = end - deg[x];
+                std::sort(buf.begin() + begin, buf.begin() + end);
+                for (long long k = begin; k < end; k += block_size) {
+                    long long block_end = std::min(k + block_size, end);
+                    block_first.push_back(buf[k]);
+                    for (long long t = k + 1; t < block_end; ++t) {
+                        put_varint((unsigned)(buf[t] - buf[t - 1]));
+                    }
+                    block_offset.push_back((long long)data.size());
+                }
+                block_begin[x + 1] = (long long)block_first.size();
+            }
+            lo = hi;
+        }
+        data.shrink_to_fit();
+    }
+
+    int degree(int x) const { return deg[x]; }
+
+    // decodes the b-th block (global block id) of x into out, returns the number of neighbors
+    int decode_block(int x, long long b, int *out) const {
+        int len = b + 1 < block_begin[x + 1] ? block_size : deg[x] - (int)(b - block_begin[x]) * block_size;
+        const uint8_t *p = data.data() + block_offset[b];
+        int val = block_first[b];
+        out[0] = val;
+        for (int k = 1; k < len; ++k) {
+            unsigned delta = 0;
+            int shift = 0;
+            while (*p & 0x80) {
+                delta |= (unsigned)(*p++ & 0x7f) << shift;
+                shift += 7;
+            }
+            delta |= (unsigned)(*p++) << shift;
+            val += (int)delta;
+            out[k] = val;
+        }
+        return len;
+    }
+
+    void decode(int x, std::vector<int> &out) const {
+        out.resize(deg[x]);
+        int pos = 0;
+        for (long long b = block_begin[x]; b < block_begin[x + 1]; ++b) {
+            pos += decode_block(x, b, out.data() + pos);
+        }
+    }
+
+    // calls f(z) for every common neighbor z of x and y, in increasing order;
+    // a block is skipped without decoding when it ends before the current block of the other list starts
+    template <class F>
+    void for_each_common(int x, int y, F f) const {
+        long long bx = block_begin[x], ex = block_begin[x + 1], by = block_begin[y], ey = block_begin[y + 1];
+        int buf_x[block_size], buf_y[block_size];
+        int len_x = -1, len_y = -1, ix = 0, iy = 0;
+        while (bx < ex && by < ey) {
+            int hi_x = bx + 1 < ex ? block_first[bx + 1] : INT_MAX;
+            int hi_y = by + 1 < ey ? block_first[by + 1] : INT_MAX;
+            if (hi_x <= block_first[by]) {
+                ++bx, len_x = -1, ix = 0;
+                continue;
+            }
+            if (hi_y <= block_first[bx]) {
+                ++by, len_y = -1, iy = 0;
+                continue;
+            }
+            if (len_x < 0) len_x = decode_block(x, bx, buf_x);
+            if (len_y < 0) len_y = decode_block(y, by, buf_y);
+            while (ix < len_x && iy < len_y) {
+                if (buf_x[ix] < buf_y[iy]) ++ix;
+                else if (buf_x[ix] > buf_y[iy]) ++iy;
+                else f(buf_x[ix]), ++ix, ++iy;
+            }
+            if (ix == len_x) ++bx, len_x = -1, ix = 0;
+            if (iy == len_y) ++by, len_y = -1, iy = 0;
+        }
+    }
+
+    long long intersection_size(int x, int y) const {
+        long long res = 0;
+        for_each_common(x, y, [&](int) { ++res; });
+        return res;
+    }
+
+    // |N(x) & b| for a sorted (decoded) list b
+    long long intersection_size(int x, const int *b, int len_b) const {
+        long long res = 0;
+        int buf[block_size];
+        const int *pb = b, *end_b = b + len_b;
+        for (long long bx = block_begin[x]; bx < block_begin[x + 1] && pb < end_b; ++bx) {
+            int hi_x = bx + 1 < block_begin[x + 1] ? block_first[bx + 1] : INT_MAX;
+            if (hi_x <= *pb) continue;
+            pb = std::lower_bound(pb, end_b, block_first[bx]);
+            int len = decode_block(x, bx, buf), k = 0;
+            while (k < len && pb < end_b) {
+                if (buf[k] < *pb) ++k;
+                else if (buf[k] > *pb) ++pb;
+                else ++res, ++k, ++pb;
+            }
+        }
+        return res;
+    }
+
+    size_t bytes() const {
+        return deg.size() * sizeof(int) + block_begin.size() * sizeof(long long) + block_first.size() * sizeof(int) +
+               block_offset.size() * sizeof(long long) + data.size();
+    }
+
+private:
+    void put_varint(unsigned delta) {
+        while (delta >= 0x80) {
+            data.push_back((uint8_t)(delta | 0x80));
+            delta >>= 7;
+        }
+        data.push_back((uint8_t)delta);
+    }
+
+    std::vector<int> deg;
+    std::vector<long long> block_begin;   // blocks of x: [block_begin[x], block_begin[x + 1])
+    std::vector<int> block_first;         // first neighbor of each block
+    std::vector<long long> block_offset;  // varint deltas of block b: data[block_offset[b], block_offset[b + 1])
+    std::vector<uint8_t> data;
+};
@@ -1,7 +1,5 @@
 // https://stackoverflow.com/questions/67066766/how-to-calculate-edge-betweenness-with-bgl
 #include <boost/bimap.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/betweenness_centrality.hpp>
 #include <algorithm>
 #include <bitset>
 #include <cassert>
@@ -23,15 +21,9 @@
 #include <unordered_set>
 #include <vector>
 
-using Mappings = boost::bimap<std::string, int>;
-
-using Graph_type =
-    boost::adjacency_list<boost::setS, boost::vecS, boost::bidirectionalS,
-                          boost::no_property,
-                          boost::property<boost::edge_weight_t, float>>;
+#include "edge_betweenness.h"
 
-using Vertex = typename boost::graph_traits<Graph_type>::vertex_descriptor;
-using Edge = std::pair<Vertex, Vertex>;
+using Mappings = boost::bimap<std::string, int>;
 
 Graph_type readInGraph(std::string const& fname, Mappings& mappings) {
     std::ifstream myFile(fname);
@@ -55,12 +47,8 @@ Graph_type readInGraph(std::string const& fname, Mappings& mappings) {
         edge_array.emplace_back(s, t);
     }
 
-    std::vector<float> transmission_delay(edge_array.size(),
-                                          1.f);  // no edge weights
-
     int const numVertices = mappings.size();
-    return Graph_type(edge_array.data(), edge_array.data() + edge_array.size(),
-                      transmission_delay.data(), numVertices);
+    return make_graph(edge_array, numVertices);
 }
 
 int main(int argc, char *argv[]) {
@@ -109,11 +97,7 @@ int main(int argc, char *argv[]) {
     Graph_type g = readInGraph(edge_input, mappings);
     std::ofstream fout;
 
-    using ECMap = std::map<Graph_type::edge_descriptor, double>;
-    using ECEntry = ECMap::value_type;
-    ECMap ecm;
-    brandes_betweenness_centrality(
-        g, boost::edge_centrality_map(boost::make_assoc_property_map(ecm)));
+    ECMap ecm = edge_betweenness(g);
 
     std::vector<std::reference_wrapper<ECEntry>> ranking(ecm.begin(), ecm.end());
 
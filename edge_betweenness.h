@@ -0,0 +1,37 @@
+#pragma once
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/betweenness_centrality.hpp>
+#include <map>
+#include <utility>
+#include <vector>
+
+// the graph and the edge betweenness routine of eb.cpp (BGL's Brandes), shared with bench.cpp so that its
+// e2e_eb benchmark times the same call
+
+using Graph_type =
+    boost::adjacency_list<boost::setS, boost::vecS, boost::bidirectionalS,
+                          boost::no_property,
+                          boost::property<boost::edge_weight_t, float>>;
+
+using Vertex = typename boost::graph_traits<Graph_type>::vertex_descriptor;
+using Edge = std::pair<Vertex, Vertex>;
+
+using ECMap = std::map<Graph_type::edge_descriptor, double>;
+using ECEntry = ECMap::value_type;
+
+// the graph of the given edges on the vertices [0, numVertices), unweighted
+inline Graph_type make_graph(std::vector<Edge> const& edge_array, int numVertices) {
+    std::vector<float> transmission_delay(edge_array.size(),
+                                          1.f);  // no edge weights
+    return Graph_type(edge_array.data(), edge_array.data() + edge_array.size(),
+                      transmission_delay.data(), numVertices);
+}
+
+// the betweenness of every edge of g
+inline ECMap edge_betweenness(Graph_type const& g) {
+    ECMap ecm;
+    brandes_betweenness_centrality(
+        g, boost::edge_centrality_map(boost::make_assoc_property_map(ecm)));
+    return ecm;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include "compressed_adj.h"
+
+// the per-edge kernels of metrics.cpp, local_path.cpp and cn_pairs.cpp, for the std::set neighbor lists and for
+// the "--compressed" ones (compressed_adj.h); bench.cpp times these same functions, so that its regression gate
+// measures the code the programs run
+// the FM and path kernels count over the slice [start, end) of N(u) (all of it for start = 0, end = d_u), so that
+// a heavy edge can be split across the threads (see slice_edges)
+
+// the CNs of u and v, in increasing order, appended to out
+inline void common_neighbors(const std::vector<std::set<int>> &v2Nv, int u, int v, std::vector<int> &out) {
+    std::set_intersection(v2Nv[u].begin(), v2Nv[u].end(), v2Nv[v].begin(), v2Nv[v].end(), std::back_inserter(out));
+}
+
+inline void common_neighbors(const CompressedAdj &adj, int u, int v, std::vector<int> &out) {
+    adj.for_each_common(u, v, [&](int x) { out.push_back(x); });
+}
+
+// |N(u) & N(v)|
+inline long long count_common(const std::vector<std::set<int>> &v2Nv, int u, int v) {
+    std::vector<int> intersect;
+    common_neighbors(v2Nv, u, v, intersect);
+    return (long long)intersect.size();
+}
+
+inline long long count_common(const CompressedAdj &adj, int u, int v) {
+    return adj.intersection_size(u, v);
+}
+
+// FM: the pairs (x, y), x in the slice of N(u) and y in N(v), with x == y or y in N(x)
+inline long long count_fm(const std::vector<std::set<int>> &v2Nv, int u, int v, int start, int end) {
+    long long fm = 0;
+    auto x = std::next(v2Nv[u].begin(), start);
+    for (auto t = start; t < end; ++t, ++x) {
+        for (auto y : v2Nv[v]) {
+            if (*x == y || v2Nv[*x].contains(y)) ++fm;
+        }
+    }
+    return fm;
+}
+
+// the same count: x == y for the CNs, and y in N(x) for |N(x) & N(v)| of each x, intersected block by block
+inline long long count_fm(const CompressedAdj &adj, int u, int v, int start, int end) {
+    std::vector<int> N_u, N_v;
+    adj.decode(u, N_u);
+    adj.decode(v, N_v);
+    long long fm = 0;
+    for (auto t = start; t < end; ++t) {
+        fm += std::binary_search(N_v.begin(), N_v.end(), N_u[t]);
+        fm += adj.intersection_size(N_u[t], N_v.data(), (int)N_v.size());
+    }
+    return fm;
+}
+
+// the paths u - x - y - v (x != y) of LP: x in the slice of N(u) and y in N(x) & N(v)
+inline long long count_paths(const std::vector<std::set<int>> &v2Nv, int u, int v, int start, int end) {
+    long long paths = 0;
+    auto x = std::next(v2Nv[u].begin(), start);
+    for (auto t = start; t < end; ++t, ++x) {
+        for (auto y : v2Nv[v]) {
+            if (*x == y) continue;
+            if (v2Nv[*x].contains(y)) ++paths;
+        }
+    }
+    return paths;
+}
+
+inline long long count_paths(const CompressedAdj &adj, int u, int v, int start, int end) {
+    std::vector<int> N_u, N_v;
+    adj.decode(u, N_u);
+    adj.decode(v, N_v);
+    long long paths = 0;
+    for (auto t = start; t < end; ++t) {
+        paths += adj.intersection_size(N_u[t], N_v.data(), (int)N_v.size());
+    }
+    return paths;
+}
+
+// a slice [start, end) of N(u) of an edge (u, v), with u the endpoint of the longer list
+struct EdgeSlice {
+    int edge, u, v, start, end;
+};
+
+// FM and the paths are symmetric in u and v, so each edge is cut into min(d, n_slices) slices of the longer of its
+// two neighbor lists (d neighbors); the slices follow the order of edges
+inline std::vector<EdgeSlice> slice_edges(const std::vector<int> &edges, const std::vector<int> &uu,
+                                          const std::vector<int> &vv, std::function<int(int)> degree, int n_slices) {
+    std::vector<EdgeSlice> slices;
+    for (auto i : edges) {
+        int u = uu[i], v = vv[i];
+        if (degree(u) < degree(v)) std::swap(u, v);
+        int d = degree(u);
+        int k = std::min(d, n_slices);
+        for (int s = 0; s < k; ++s) {
+            slices.push_back({i, u, v, (int)((long long)d * s / k), (int)((long long)d * (s + 1) / k)});
+        }
+    }
+    return slices;
+}
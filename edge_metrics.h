@@ -0,0 +1,178 @@
+#pragma once
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "compressed_adj.h"
+#include "edge_kernels.h"
+#include "perf_profile.h"
+
+// the per-edge metrics of metrics.cpp and the schedule it runs them with (the FM of the heavy edges split across
+// the threads, then chunks of edges by decreasing cost); bench.cpp's e2e_metrics runs this same code
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(i) : your function processing the element i.
+/// each thread takes the next unprocessed element when done with its previous one,
+/// so that with the elements ordered by decreasing cost, the expensive ones start first
+/// and the threads finish at about the same time
+inline void parallel_for_dynamic(unsigned nb_elements, std::function<void(int i)> functor) {
+    unsigned nb_threads_hint = std::thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+    std::atomic<unsigned> next(0);
+    std::vector<std::thread> my_threads(nb_threads);
+    for (unsigned t = 0; t < nb_threads; ++t) {
+        my_threads[t] = std::thread([&]() {
+            for (unsigned i = next++; i < nb_elements; i = next++) functor(i);
+        });
+    }
+    std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// splits [0, costs.size()) into n_shards contiguous ranges of about equal total cost
+// the s-th range is [bounds[s], bounds[s + 1])
+inline std::vector<int> balanced_split(const std::vector<double> &costs, int n_shards) {
+    std::vector<double> prefix(costs.size() + 1, 0.);
+    std::partial_sum(costs.begin(), costs.end(), prefix.begin() + 1);
+    std::vector<int> bounds(n_shards + 1, (int)costs.size());
+    bounds[0] = 0;
+    for (int s = 1; s < n_shards; ++s) {
+        double target = prefix.back() * s / n_shards;
+        bounds[s] = (int)(std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin());
+        bounds[s] = std::max(bounds[s], bounds[s - 1]);
+    }
+    return bounds;
+}
+
+inline int node_degree(const std::vector<std::set<int>> &v2Nv, int x) {
+    return (int)v2Nv[x].size();
+}
+
+inline int node_degree(const CompressedAdj &adj, int x) {
+    return adj.degree(x);
+}
+
+// edge (u, v) costs about d_u * d_v for FM plus d_u + d_v for the intersection
+template <class Adj>
+std::vector<double> edge_costs(const Adj &adj, const std::vector<int> &uu, const std::vector<int> &vv) {
+    std::vector<double> edge_cost(uu.size());
+    for (size_t i = 0; i < uu.size(); ++i) {
+        double dd_u = (double)node_degree(adj, uu[i]), dd_v = (double)node_degree(adj, vv[i]);
+        edge_cost[i] = dd_u * dd_v + dd_u + dd_v;
+    }
+    return edge_cost;
+}
+
+struct EdgeMetrics {
+    double cn, sa, jc, hp, hd, si, li, aa, ra, pa, fm, dl;
+};
+
+// the metrics of the edge (u, v); its FM is counted here unless given (fm >= 0, from the heavy-edge split)
+template <class Adj>
+EdgeMetrics edge_metrics(const Adj &adj, int u, int v, double fm = -1.) {
+    int d_u = node_degree(adj, u);
+    int d_v = node_degree(adj, v);
+    double dd_u = (double)d_u;
+    double dd_v = (double)d_v;
+    std::vector<int> intersect;
+    intersect.reserve(std::min(d_u, d_v));
+    common_neighbors(adj, u, v, intersect);
+    EdgeMetrics r;
+    // name2metric['CN'] = cn_uv
+    double cn_i = (double)intersect.size();
+    r.cn = cn_i;
+    // name2metric['SA'] = cn_uv / math.sqrt(du * dv)
+    r.sa = cn_i / sqrt(dd_u * dd_v);
+    // name2metric['JC'] = cn_uv / (du + dv - cn_uv)
+    r.jc = cn_i / (dd_u + dd_v - cn_i);
+    // name2metric['HP'] = cn_uv / min(du, dv)
+    r.hp = cn_i / std::min(dd_u, dd_v);
+    // name2metric['HD'] = cn_uv / max(du, dv)
+    r.hd = cn_i / std::max(dd_u, dd_v);
+    // name2metric['SI'] = cn_uv / (du + dv)
+    r.si = cn_i / (dd_u + dd_v);
+    // name2metric['LI'] = cn_uv / (du * dv)
+    r.li = cn_i / (dd_u * dd_v);
+    // for x in CN_uv:
+    //     name2metric['AA'] += 1 / math.log(degrees[x])
+    //     name2metric['RA'] += 1 / degrees[x]
+    double aa_i = 0., ra_i = 0.;
+    for (auto x : intersect) {
+        double dd_x = (double)node_degree(adj, x);
+        aa_i += 1 / log(dd_x);
+        ra_i += 1 / dd_x;
+    }
+    r.aa = aa_i;
+    r.ra = ra_i;
+    // name2metric['PA'] = du * dv
+    r.pa = dd_u * dd_v;
+    // name2metric['FM'] = cn_uv
+    // for x, y in product(Nu - Nv, Nv - Nu):
+    //     if y in neighbors_list[x]:
+    //         name2metric['FM'] += 1
+    r.fm = fm >= 0 ? fm : (double)count_fm(adj, u, v, 0, d_u);
+    // name2metric['DL'] = du + dv - 2
+    r.dl = dd_u + dd_v - 2;
+    return r;
+}
+
+// the metrics of the edges edge_lo + [chunk_bounds[c], chunk_bounds[c + 1]) of the chunks c in todo
+// a hub-hub edge alone can cost more than the work of a whole thread, so the FM of the edges above heavy_share
+// of the total cost (of all the chunks) per thread is computed first, each split across all the threads;
+// on_heavy(number of heavy edges) is called then, and the chunks go next, the most expensive first, each thread
+// taking the next one when done: on_edge(i, metrics) for each edge i and on_chunk(c) once chunk c is complete
+template <class Adj>
+void schedule_edge_metrics(const Adj &adj, const std::vector<int> &uu, const std::vector<int> &vv,
+                           const std::vector<double> &edge_cost, int edge_lo, const std::vector<int> &chunk_bounds,
+                           std::vector<int> todo, std::function<void(int n_heavy)> on_heavy,
+                           std::function<void(int i, const EdgeMetrics &metrics)> on_edge,
+                           std::function<void(int chunk)> on_chunk) {
+    unsigned nb_threads_hint = std::thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+    const double heavy_share = 1. / 16;
+    int n_chunks = (int)chunk_bounds.size() - 1;
+    double total_cost = std::accumulate(edge_cost.begin() + edge_lo + chunk_bounds[0],
+                                        edge_cost.begin() + edge_lo + chunk_bounds[n_chunks], 0.);
+    double heavy_threshold = std::max(total_cost / nb_threads * heavy_share, 1e6);
+    auto degree = [&](int x) { return node_degree(adj, x); };
+    std::vector<int> heavy;
+    std::vector<double> chunk_cost(n_chunks, 0.);
+    for (auto chunk : todo) {
+        for (auto i = edge_lo + chunk_bounds[chunk]; i < edge_lo + chunk_bounds[chunk + 1]; ++i) {
+            if (edge_cost[i] > heavy_threshold) {
+                heavy.push_back(i);
+                chunk_cost[chunk] += degree(uu[i]) + degree(vv[i]);
+            } else {
+                chunk_cost[chunk] += edge_cost[i];
+            }
+        }
+    }
+    std::sort(heavy.begin(), heavy.end(), [&](int i, int j) { return edge_cost[i] > edge_cost[j]; });
+    // the slices of all the heavy edges go through one dynamic pool, the most expensive edges first
+    auto slices = slice_edges(heavy, uu, vv, degree, (int)nb_threads);
+    std::vector<long long> slice_fm(slices.size(), 0);
+    parallel_for_dynamic(slices.size(), [&](int k) {
+        Profiler::thread_enter();
+        auto &sl = slices[k];
+        slice_fm[k] = count_fm(adj, sl.u, sl.v, sl.start, sl.end);
+    });
+    std::map<int, double> heavy_fm;
+    for (size_t k = 0; k < slices.size(); ++k) heavy_fm[slices[k].edge] += (double)slice_fm[k];
+    on_heavy((int)heavy.size());
+    std::sort(todo.begin(), todo.end(), [&](int a, int b) { return chunk_cost[a] > chunk_cost[b]; });
+    parallel_for_dynamic(todo.size(), [&](int t) {
+        Profiler::thread_enter();
+        int chunk = todo[t];
+        for (auto i = edge_lo + chunk_bounds[chunk]; i < edge_lo + chunk_bounds[chunk + 1]; ++i) {
+            auto it = heavy_fm.find(i);
+            on_edge(i, edge_metrics(adj, uu[i], vv[i], it == heavy_fm.end() ? -1. : it->second));
+        }
+        on_chunk(chunk);
+    });
+}
@@ -0,0 +1,631 @@
+// in-process Python bindings (CPython + NumPy C API) of the kernels of metrics.cpp, local_path.cpp, cn_pairs.cpp and eb.cpp
+// build: python setup.py build_ext --inplace
+//
+//     import graph_kernels
+//     edges, weights = graph_kernels.read_edge_txt('data/edge_txt/OF.edge_txt')
+//     g = graph_kernels.Graph(edges)  # or any (m, 2) integer array, e.g. np.array(load_data(graph_name, 'edges'))
+//     name2metric = g.metrics()       # {'CN': array, ..., 'DL': array}, in the order of the edges
+//     lp = g.local_path()
+//     c, count = g.cn_pairs()
+//     eb = g.edge_betweenness()       # as eb.cpp (not normalized)
+//     coreness = g.coreness()
+//
+// the results are NumPy arrays allocated up front and filled in place (no copy), and the GIL is released while computing
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
+#include <math.h>
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+mutex mut_m;
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+/// an exception thrown by the functor in any thread is rethrown here once all the threads are joined
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads;
+    exception_ptr error;
+    mutex mut_error;
+    auto guarded = [&](int start, int end) {
+        try {
+            functor(start, end);
+        } catch (...) {
+            lock_guard<mutex> lock(mut_error);
+            if (!error) error = current_exception();
+        }
+    };
+
+    if (use_threads) {
+        // Multithread execution
+        try {
+            for (unsigned i = 0; i < nb_threads; ++i) {
+                int start = i * batch_size;
+                my_threads.emplace_back(guarded, start, start + batch_size);
+            }
+        } catch (...) {
+            std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+            throw;
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            guarded(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    guarded(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+    if (error) rethrow_exception(error);
+}
+
+// runs f(w) for w = 0, ..., k - 1, each on its own thread; an exception is rethrown once all are joined
+static void run_workers(int k, function<void(int w)> f) {
+    vector<thread> threads;
+    exception_ptr error;
+    mutex mut_error;
+    auto guarded = [&](int w) {
+        try {
+            f(w);
+        } catch (...) {
+            lock_guard<mutex> lock(mut_error);
+            if (!error) error = current_exception();
+        }
+    };
+    try {
+        for (int w = 1; w < k; ++w) threads.emplace_back(guarded, w);
+    } catch (...) {
+        std::for_each(threads.begin(), threads.end(), std::mem_fn(&std::thread::join));
+        throw;
+    }
+    if (k > 0) guarded(0);
+    std::for_each(threads.begin(), threads.end(), std::mem_fn(&std::thread::join));
+    if (error) rethrow_exception(error);
+}
+
+// runs f with the GIL released; a C++ exception escaping it (bad_alloc on a large graph, ...) is caught before
+// the GIL is taken back and raised as MemoryError or RuntimeError; false when an exception was raised
+static bool without_gil(function<void()> f) {
+    bool no_memory = false, failed = false;
+    string what;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        f();
+    } catch (const bad_alloc &) {
+        no_memory = true;
+    } catch (const exception &e) {
+        failed = true;
+        try {
+            what = e.what();
+        } catch (...) {
+        }
+    } catch (...) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (no_memory) {
+        PyErr_NoMemory();
+        return false;
+    }
+    if (failed) {
+        PyErr_SetString(PyExc_RuntimeError, what.empty() ? "unknown C++ exception" : what.c_str());
+        return false;
+    }
+    return true;
+}
+
+// the edge list (in the given order) and the sorted, deduplicated neighbor lists in CSR form
+struct GraphData {
+    int n = 0, m = 0;
+    vector<int> uu, vv;
+    vector<long long> offsets;
+    vector<int> nbrs;
+
+    GraphData(int n, vector<int> uu_, vector<int> vv_) : n(n), m((int)uu_.size()), uu(std::move(uu_)), vv(std::move(vv_)) {
+        offsets.assign(n + 1, 0);
+        for (int i = 0; i < m; ++i) {
+            ++offsets[uu[i] + 1];
+            ++offsets[vv[i] + 1];
+        }
+        partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        vector<int> raw(offsets[n]);
+        vector<long long> cursor(offsets.begin(), offsets.end() - 1);
+        for (int i = 0; i < m; ++i) {
+            raw[cursor[uu[i]]++] = vv[i];
+            raw[cursor[vv[i]]++] = uu[i];
+        }
+        // like the std::set neighbor lists of the programs, repeated edges count once
+        vector<long long> dedup(n + 1, 0);
+        nbrs.reserve(raw.size());
+        for (int x = 0; x < n; ++x) {
+            sort(raw.begin() + offsets[x], raw.begin() + offsets[x + 1]);
+            auto last = unique(raw.begin() + offsets[x], raw.begin() + offsets[x + 1]);
+            nbrs.insert(nbrs.end(), raw.begin() + offsets[x], last);
+            dedup[x + 1] = (long long)nbrs.size();
+        }
+        offsets.swap(dedup);
+    }
+
+    int degree(int x) const { return (int)(offsets[x + 1] - offsets[x]); }
+    const int *begin(int x) const { return nbrs.data() + offsets[x]; }
+    const int *end(int x) const { return nbrs.data() + offsets[x + 1]; }
+
+    long long intersection_size(const int *a, const int *a_end, const int *b, const int *b_end) const {
+        long long res = 0;
+        while (a != a_end && b != b_end) {
+            if (*a < *b) ++a;
+            else if (*a > *b) ++b;
+            else ++res, ++a, ++b;
+        }
+        return res;
+    }
+
+    // |N(x) & N(v)| summed over x in N(u): the 2-hop part of FM and LP
+    long long two_hop_paths(int u, int v) const {
+        long long res = 0;
+        for (auto x = begin(u); x != end(u); ++x) {
+            res += intersection_size(begin(*x), end(*x), begin(v), end(v));
+        }
+        return res;
+    }
+};
+
+struct GraphObject {
+    PyObject_HEAD
+    GraphData *g;
+};
+
+static PyArrayObject *new_array(int nd, npy_intp *dims, int type) {
+    return (PyArrayObject *)PyArray_SimpleNew(nd, dims, type);
+}
+
+static void Graph_dealloc(GraphObject *self) {
+    delete self->g;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int Graph_init(GraphObject *self, PyObject *args, PyObject *kwds) {
+    static const char *kwlist[] = {"edges", "n", nullptr};
+    PyObject *edges_obj;
+    int n = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|i", (char **)kwlist, &edges_obj, &n)) return -1;
+    auto *edges = (PyArrayObject *)PyArray_FROM_OTF(edges_obj, NPY_INT32, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (!edges) return -1;
+    if (PyArray_NDIM(edges) != 2 || PyArray_DIM(edges, 1) < 2) {
+        Py_DECREF(edges);
+        PyErr_SetString(PyExc_ValueError, "edges must have shape (m, 2) (extra columns are ignored)");
+        return -1;
+    }
+    int m = (int)PyArray_DIM(edges, 0), cols = (int)PyArray_DIM(edges, 1);
+    const int32_t *e = (const int32_t *)PyArray_DATA(edges);
+    vector<int> uu(m), vv(m);
+    int id_min = 0, id_max = -1;
+    for (int i = 0; i < m; ++i) {
+        uu[i] = e[(size_t)i * cols];
+        vv[i] = e[(size_t)i * cols + 1];
+        id_min = min(id_min, min(uu[i], vv[i]));
+        id_max = max(id_max, max(uu[i], vv[i]));
+    }
+    Py_DECREF(edges);
+    if (n < 0) n = id_max + 1;
+    if (id_min < 0 || id_max >= n) {
+        PyErr_SetString(PyExc_ValueError, "node ids must be in [0, n)");
+        return -1;
+    }
+    // the methods read the graph with the GIL released, so a graph in use is never replaced:
+    // it is built into a local and only set (with the GIL held) if the object has none yet
+    if (self->g) {
+        PyErr_SetString(PyExc_RuntimeError, "Graph is already initialized");
+        return -1;
+    }
+    GraphData *g = nullptr;
+    if (!without_gil([&]() { g = new GraphData(n, std::move(uu), std::move(vv)); })) return -1;
+    if (self->g) {
+        delete g;
+        PyErr_SetString(PyExc_RuntimeError, "Graph is already initialized");
+        return -1;
+    }
+    self->g = g;
+    return 0;
+}
+
+static PyObject *Graph_get_n(GraphObject *self, void *) { return PyLong_FromLong(self->g ? self->g->n : 0); }
+
+static PyObject *Graph_get_m(GraphObject *self, void *) { return PyLong_FromLong(self->g ? self->g->m : 0); }
+
+static bool check_init(GraphObject *self) {
+    if (self->g) return true;
+    PyErr_SetString(PyExc_RuntimeError, "Graph is not initialized");
+    return false;
+}
+
+// the 12 metrics of metrics.cpp, as a dict of float64 arrays
+static PyObject *Graph_metrics(GraphObject *self, PyObject *) {
+    if (!check_init(self)) return nullptr;
+    const GraphData &g = *self->g;
+    const char *names[] = {"CN", "SA", "JC", "HP", "HD", "SI", "LI", "AA", "RA", "PA", "FM", "DL"};
+    const int n_metrics = 12;
+    npy_intp dims[1] = {g.m};
+    PyArrayObject *arrays[n_metrics];
+    double *cols[n_metrics];
+    for (int j = 0; j < n_metrics; ++j) {
+        arrays[j] = new_array(1, dims, NPY_FLOAT64);
+        if (!arrays[j]) {
+            for (int k = 0; k < j; ++k) Py_DECREF(arrays[k]);
+            return nullptr;
+        }
+        cols[j] = (double *)PyArray_DATA(arrays[j]);
+    }
+    bool ok = without_gil([&]() {
+        parallel_for(g.m, [&](int start, int end) {
+            vector<int> intersect;
+            for (auto i = start; i < end; ++i) {
+                int u_i = g.uu[i], v_i = g.vv[i];
+                double dd_u = (double)g.degree(u_i);
+                double dd_v = (double)g.degree(v_i);
+                intersect.clear();
+                set_intersection(g.begin(u_i), g.end(u_i), g.begin(v_i), g.end(v_i), back_inserter(intersect));
+                double cn_i = (double)intersect.size();
+                double aa_i = 0., ra_i = 0.;
+                for (auto x : intersect) {
+                    double dd_x = (double)g.degree(x);
+                    aa_i += 1 / log(dd_x);
+                    ra_i += 1 / dd_x;
+                }
+                cols[0][i] = cn_i;
+                cols[1][i] = cn_i / sqrt(dd_u * dd_v);
+                cols[2][i] = cn_i / (dd_u + dd_v - cn_i);
+                cols[3][i] = cn_i / min(dd_u, dd_v);
+                cols[4][i] = cn_i / max(dd_u, dd_v);
+                cols[5][i] = cn_i / (dd_u + dd_v);
+                cols[6][i] = cn_i / (dd_u * dd_v);
+                cols[7][i] = aa_i;
+                cols[8][i] = ra_i;
+                cols[9][i] = dd_u * dd_v;
+                // the count of metrics.cpp: x == y for the CNs, and y in N(x) for |N(x) & N(v)| of each x
+                cols[10][i] = cn_i + (double)g.two_hop_paths(u_i, v_i);
+                cols[11][i] = dd_u + dd_v - 2;
+            }
+        });
+    });
+    if (!ok) {
+        for (int j = 0; j < n_metrics; ++j) Py_DECREF(arrays[j]);
+        return nullptr;
+    }
+    PyObject *res = PyDict_New();
+    for (int j = 0; j < n_metrics; ++j) {
+        if (res) PyDict_SetItemString(res, names[j], (PyObject *)arrays[j]);
+        Py_DECREF(arrays[j]);
+    }
+    return res;
+}
+
+// LP of local_path.cpp
+static PyObject *Graph_local_path(GraphObject *self, PyObject *args, PyObject *kwds) {
+    if (!check_init(self)) return nullptr;
+    static const char *kwlist[] = {"epsilon", nullptr};
+    double epsilon = 0.001;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|d", (char **)kwlist, &epsilon)) return nullptr;
+    const GraphData &g = *self->g;
+    npy_intp dims[1] = {g.m};
+    PyArrayObject *arr = new_array(1, dims, NPY_FLOAT64);
+    if (!arr) return nullptr;
+    double *lp = (double *)PyArray_DATA(arr);
+    bool ok = without_gil([&]() {
+        parallel_for(g.m, [&](int start, int end) {
+            for (auto i = start; i < end; ++i) {
+                int u_i = g.uu[i], v_i = g.vv[i];
+                // 1 + CN + epsilon per path u - x - y - v, as in local_path.cpp
+                double cn_i = (double)g.intersection_size(g.begin(u_i), g.end(u_i), g.begin(v_i), g.end(v_i));
+                lp[i] = 1. + cn_i + (double)g.two_hop_paths(u_i, v_i) * epsilon;
+            }
+        });
+    });
+    if (!ok) {
+        Py_DECREF(arr);
+        return nullptr;
+    }
+    return (PyObject *)arr;
+}
+
+// the histogram of cn_pairs.cpp, as (c, number of pairs sharing c CNs) int64 arrays sorted by c
+static PyObject *Graph_cn_pairs(GraphObject *self, PyObject *) {
+    if (!check_init(self)) return nullptr;
+    const GraphData &g = *self->g;
+    map<int, long long> cn2p;
+    bool ok = without_gil([&]() {
+        parallel_for(max(g.n - 1, 0), [&](int start, int end) {
+            map<int, long long> cn2p_local;
+            for (int i = start; i < end; ++i) {
+                for (int j = i + 1; j < g.n; ++j) {
+                    ++cn2p_local[(int)g.intersection_size(g.begin(i), g.end(i), g.begin(j), g.end(j))];
+                }
+            }
+            mut_m.lock();
+            for (auto const &x: cn2p_local) cn2p[x.first] += x.second;
+            mut_m.unlock();
+        });
+    });
+    if (!ok) return nullptr;
+    npy_intp dims[1] = {(npy_intp)cn2p.size()};
+    PyArrayObject *c = new_array(1, dims, NPY_INT64), *count = new_array(1, dims, NPY_INT64);
+    if (!c || !count) {
+        Py_XDECREF(c);
+        Py_XDECREF(count);
+        return nullptr;
+    }
+    auto *pc = (int64_t *)PyArray_DATA(c), *pcount = (int64_t *)PyArray_DATA(count);
+    for (auto const &x: cn2p) *pc++ = x.first, *pcount++ = x.second;
+    return Py_BuildValue("(NN)", c, count);
+}
+
+// Brandes edge betweenness over all sources, which counts each pair of nodes twice; halved, it is the value of eb.cpp
+// (one direction of each edge of the symmetric digraph)
+static PyObject *Graph_edge_betweenness(GraphObject *self, PyObject *) {
+    if (!check_init(self)) return nullptr;
+    const GraphData &g = *self->g;
+    npy_intp dims[1] = {g.m};
+    PyArrayObject *arr = new_array(1, dims, NPY_FLOAT64);
+    if (!arr) return nullptr;
+    double *eb = (double *)PyArray_DATA(arr);
+    bool ok = without_gil([&]() {
+        // the sources are cut into eb_chunks fixed ranges, each accumulated (per edge id) from zero in its own buffer
+        // and added to eb in the order of the ranges, so that the sums do not depend on the number of threads or on
+        // their timing; the ranges run eb_workers at a time, so at most eb_workers buffers of m doubles are resident
+        const int eb_chunks = 256, eb_workers = 8;
+        unsigned nb_threads_hint = thread::hardware_concurrency();
+        int workers = min(eb_workers, nb_threads_hint == 0 ? 8 : (int)nb_threads_hint);
+        // the edge id of each adjacency slot (the slot of v in N(u) and that of u in N(v) are edge (u, v));
+        // a repeated edge has one slot, accumulated under its last id (edge_rep) and copied to the others
+        vector<int> slot_edge(g.nbrs.size()), edge_rep(g.m);
+        for (int i = 0; i < g.m; ++i) {
+            int u_i = g.uu[i], v_i = g.vv[i];
+            slot_edge[lower_bound(g.begin(u_i), g.end(u_i), v_i) - g.nbrs.data()] = i;
+            slot_edge[lower_bound(g.begin(v_i), g.end(v_i), u_i) - g.nbrs.data()] = i;
+        }
+        for (int i = 0; i < g.m; ++i) {
+            edge_rep[i] = slot_edge[lower_bound(g.begin(g.uu[i]), g.end(g.uu[i]), g.vv[i]) - g.nbrs.data()];
+        }
+        fill(eb, eb + g.m, 0.);
+        vector<vector<double>> chunk_eb(workers, vector<double>(g.m));
+        for (int wave = 0; wave < eb_chunks; wave += workers) {
+            int n_chunks = min(workers, eb_chunks - wave);
+            run_workers(n_chunks, [&](int w) {
+                vector<double> sigma(g.n, 0.), delta(g.n, 0.);
+                vector<int> dist(g.n, -1), order;
+                order.reserve(g.n);
+                vector<double> &acc = chunk_eb[w];
+                fill(acc.begin(), acc.end(), 0.);
+                int chunk = wave + w;
+                int s_lo = (int)((long long)g.n * chunk / eb_chunks), s_hi = (int)((long long)g.n * (chunk + 1) / eb_chunks);
+                for (int s = s_lo; s < s_hi; ++s) {
+                    order.clear();
+                    dist[s] = 0;
+                    sigma[s] = 1.;
+                    order.push_back(s);
+                    for (size_t head = 0; head < order.size(); ++head) {
+                        int x = order[head];
+                        for (auto y = g.begin(x); y != g.end(x); ++y) {
+                            if (dist[*y] < 0) {
+                                dist[*y] = dist[x] + 1;
+                                order.push_back(*y);
+                            }
+                            if (dist[*y] == dist[x] + 1) sigma[*y] += sigma[x];
+                        }
+                    }
+                    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                        int y = *it;
+                        for (auto x = g.begin(y); x != g.end(y); ++x) {
+                            if (dist[*x] == dist[y] - 1) {
+                                double c = sigma[*x] / sigma[y] * (1. + delta[y]);
+                                delta[*x] += c;
+                                acc[slot_edge[x - g.nbrs.data()]] += c;
+                            }
+                        }
+                    }
+                    for (auto x : order) {
+                        dist[x] = -1;
+                        sigma[x] = delta[x] = 0.;
+                    }
+                }
+            });
+            parallel_for(g.m, [&](int start, int end) {
+                for (int i = start; i < end; ++i) {
+                    for (int w = 0; w < n_chunks; ++w) eb[i] += chunk_eb[w][i];
+                }
+            });
+        }
+        // edge_rep[i] >= i, so eb[edge_rep[i]] is still the sum when read
+        for (int i = 0; i < g.m; ++i) eb[i] = eb[edge_rep[i]] / 2.;
+    });
+    if (!ok) {
+        Py_DECREF(arr);
+        return nullptr;
+    }
+    return (PyObject *)arr;
+}
+
+// k-core number of each node (Batagelj and Zaversnik, bucket sort by degree)
+static PyObject *Graph_coreness(GraphObject *self, PyObject *) {
+    if (!check_init(self)) return nullptr;
+    const GraphData &g = *self->g;
+    npy_intp dims[1] = {g.n};
+    PyArrayObject *arr = new_array(1, dims, NPY_INT32);
+    if (!arr) return nullptr;
+    auto *core = (int32_t *)PyArray_DATA(arr);
+    bool ok = without_gil([&]() {
+        int n = g.n, d_max = 0;
+        for (int x = 0; x < n; ++x) {
+            core[x] = g.degree(x);
+            d_max = max(d_max, (int)core[x]);
+        }
+        vector<int> bin(d_max + 1, 0), pos(n), vert(n);
+        for (int x = 0; x < n; ++x) ++bin[core[x]];
+        for (int d = 0, start = 0; d <= d_max; ++d) {
+            int num = bin[d];
+            bin[d] = start;
+            start += num;
+        }
+        for (int x = 0; x < n; ++x) {
+            pos[x] = bin[core[x]]++;
+            vert[pos[x]] = x;
+        }
+        for (int d = d_max; d > 0; --d) bin[d] = bin[d - 1];
+        if (d_max >= 0 && n > 0) bin[0] = 0;
+        for (int k = 0; k < n; ++k) {
+            int x = vert[k];
+            for (auto y = g.begin(x); y != g.end(x); ++y) {
+                if (core[*y] > core[x]) {
+                    int d_y = core[*y], p_y = pos[*y], p_w = bin[d_y], w = vert[p_w];
+                    if (*y != w) {
+                        pos[*y] = p_w, vert[p_y] = w;
+                        pos[w] = p_y, vert[p_w] = *y;
+                    }
+                    ++bin[d_y];
+                    --core[*y];
+                }
+            }
+        }
+    });
+    if (!ok) {
+        Py_DECREF(arr);
+        return nullptr;
+    }
+    return (PyObject *)arr;
+}
+
+// reads an edge_txt file ("u v" or "u v w" per line) into an (m, 2) int32 array of edges and the weights (or None)
+static PyObject *read_edge_txt(PyObject *, PyObject *args) {
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path)) return nullptr;
+    vector<int> e, w;
+    bool opened = true, weighted = true;
+    bool ok = without_gil([&]() {
+        ifstream fin(path);
+        opened = fin.is_open();
+        string line;
+        while (opened && getline(fin, line)) {
+            istringstream iss(line);
+            int u, v, w_i;
+            if (!(iss >> u >> v)) continue;
+            e.push_back(u);
+            e.push_back(v);
+            if (iss >> w_i) w.push_back(w_i);
+            else weighted = false;
+        }
+    });
+    if (!ok) return nullptr;
+    if (!opened) {
+        PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+        return nullptr;
+    }
+    npy_intp dims[2] = {(npy_intp)e.size() / 2, 2};
+    PyArrayObject *edges = new_array(2, dims, NPY_INT32);
+    if (!edges) return nullptr;
+    copy(e.begin(), e.end(), (int32_t *)PyArray_DATA(edges));
+    if (!weighted || w.size() * 2 != e.size()) {
+        return Py_BuildValue("(NO)", edges, Py_None);
+    }
+    PyArrayObject *weights = new_array(1, dims, NPY_INT32);
+    if (!weights) {
+        Py_DECREF(edges);
+        return nullptr;
+    }
+    copy(w.begin(), w.end(), (int32_t *)PyArray_DATA(weights));
+    return Py_BuildValue("(NN)", edges, weights);
+}
+
+static PyMethodDef Graph_methods[] = {
+    {"metrics", (PyCFunction)Graph_metrics, METH_NOARGS,
+     "metrics()\n--\n\nThe per-edge metrics of metrics.cpp, as a dict of float64 arrays keyed by 'CN', ..., 'DL'."},
+    {"local_path", (PyCFunction)(void (*)(void))Graph_local_path, METH_VARARGS | METH_KEYWORDS,
+     "local_path(epsilon=0.001)\n--\n\nThe per-edge LP of local_path.cpp, as a float64 array."},
+    {"cn_pairs", (PyCFunction)Graph_cn_pairs, METH_NOARGS,
+     "cn_pairs()\n--\n\nThe histogram of cn_pairs.cpp, as a tuple (c, count) of int64 arrays."},
+    {"edge_betweenness", (PyCFunction)Graph_edge_betweenness, METH_NOARGS,
+     "edge_betweenness()\n--\n\nThe per-edge betweenness of eb.cpp (not normalized), as a float64 array."},
+    {"coreness", (PyCFunction)Graph_coreness, METH_NOARGS,
+     "coreness()\n--\n\nThe core number of each node, as an int32 array."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyGetSetDef Graph_getset[] = {
+    {"n", (getter)Graph_get_n, nullptr, "number of nodes", nullptr},
+    {"m", (getter)Graph_get_m, nullptr, "number of edges", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+static PyTypeObject GraphType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyMethodDef module_methods[] = {
+    {"read_edge_txt", read_edge_txt, METH_VARARGS,
+     "read_edge_txt(path)\n--\n\nReads an edge_txt file into (edges, weights); weights is None without a weight column."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+static PyModuleDef graph_kernels_module = {
+    PyModuleDef_HEAD_INIT, "graph_kernels", "C++ kernels of the metric, CN pair and betweenness programs.", -1,
+    module_methods
+};
+
+PyMODINIT_FUNC PyInit_graph_kernels(void) {
+    import_array();
+    GraphType.tp_name = "graph_kernels.Graph";
+    GraphType.tp_doc = "Graph(edges, n=None)\n--\n\nA graph built from an (m, 2) integer array of edges.";
+    GraphType.tp_basicsize = sizeof(GraphObject);
+    GraphType.tp_flags = Py_TPFLAGS_DEFAULT;
+    GraphType.tp_new = PyType_GenericNew;
+    GraphType.tp_init = (initproc)Graph_init;
+    GraphType.tp_dealloc = (destructor)Graph_dealloc;
+    GraphType.tp_methods = Graph_methods;
+    GraphType.tp_getset = Graph_getset;
+    if (PyType_Ready(&GraphType) < 0) return nullptr;
+    PyObject *module = PyModule_Create(&graph_kernels_module);
+    if (!module) return nullptr;
+    Py_INCREF(&GraphType);
+    if (PyModule_AddObject(module, "Graph", (PyObject *)&GraphType) < 0) {
+        Py_DECREF(&GraphType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
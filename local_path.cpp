@@ -1,5 +1,6 @@
 #include <math.h>
 #include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <cassert>
 #include <cstdlib>
@@ -20,59 +21,44 @@
 #include <unordered_set>
 #include <vector>
 
+#include "compressed_adj.h"
+#include "edge_kernels.h"
+#include "perf_profile.h"
+
 using namespace std;
 mutex mut_m, mut_n;
 
 /// @param[in] nb_elements : size of your for loop
-/// @param[in] functor(start, end) :
-/// your function processing a sub chunk of the for loop.
-/// "start" is the first index to process (included) until the index "end"
-/// (excluded)
-/// @code
-///     for(int i = start; i < end; ++i)
-///         computation(i);
-/// @endcode
-/// @param use_threads : enable / disable threads.
-///
-///
-static void parallel_for(unsigned nb_elements,
-                         function<void(int start, int end)> functor,
-                         bool use_threads = true) {
-    // -------
+/// @param[in] functor(i) : your function processing the element i.
+/// each thread takes the next unprocessed element when done with its previous one,
+/// so that with the elements ordered by decreasing cost, the expensive ones start first
+/// and the threads finish at about the same time
+static void parallel_for_dynamic(unsigned nb_elements, function<void(int i)> functor) {
     unsigned nb_threads_hint = thread::hardware_concurrency();
     unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
-
-    unsigned batch_size = nb_elements / nb_threads;
-    unsigned batch_remainder = nb_elements % nb_threads;
-
+    atomic<unsigned> next(0);
     vector<thread> my_threads(nb_threads);
-
-    if (use_threads) {
-        // Multithread execution
-        for (unsigned i = 0; i < nb_threads; ++i) {
-            int start = i * batch_size;
-            my_threads[i] = std::thread(functor, start, start + batch_size);
-        }
-    } else {
-        // Single thread execution (for easy debugging)
-        for (unsigned i = 0; i < nb_threads; ++i) {
-            int start = i * batch_size;
-            functor(start, start + batch_size);
-        }
+    for (unsigned t = 0; t < nb_threads; ++t) {
+        my_threads[t] = std::thread([&]() {
+            for (unsigned i = next++; i < nb_elements; i = next++) functor(i);
+        });
     }
-
-    // Deform the elements left
-    int start = nb_threads * batch_size;
-    functor(start, start + batch_remainder);
-
-    // Wait for the other thread to finish their task
-    if (use_threads)
-        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+    std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
 }
 
 int main(int argc, char *argv[]) {
     std::filesystem::create_directories("data/metrics_cpp");
     string dataset(argv[1]);
+    // optional "--compressed": keep the neighbor lists delta + varint encoded (compressed_adj.h) instead of in sets
+    // optional "--profile": hardware counters per phase (perf_profile.h), reported to data/profile/<name>_local_path.json
+    bool compressed = false, profile = false;
+    for (int a = 2; a < argc; ++a) {
+        if (string(argv[a]) == "--compressed") {
+            compressed = true;
+        } else if (string(argv[a]) == "--profile") {
+            profile = true;
+        }
+    }
     string dataset_full;
     int n, m;
     if (dataset == "OF") {
@@ -111,9 +97,11 @@ int main(int argc, char *argv[]) {
     } else {
         throw invalid_argument( "unknown dataset");
     }
+    Profiler prof(profile);
+    prof.phase("load");
     string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
     ifstream fin;
-    vector<set<int>> v2Nv(n);
+    vector<set<int>> v2Nv(compressed ? 0 : n);
     vector<int> uu, vv;
     uu.reserve(m);
     vv.reserve(m);
@@ -121,12 +109,23 @@ int main(int argc, char *argv[]) {
     int u, v;
     for (auto i = 0; i < m; ++i) {
         fin >> u >> v;
-        v2Nv[u].insert(v);
-        v2Nv[v].insert(u);
         uu.push_back(u);
         vv.push_back(v);
     }
     fin.close();
+    prof.phase("adjacency build");
+    if (!compressed) {
+        for (auto i = 0; i < m; ++i) {
+            v2Nv[uu[i]].insert(vv[i]);
+            v2Nv[vv[i]].insert(uu[i]);
+        }
+    }
+    CompressedAdj adj;
+    if (compressed) {
+        adj = CompressedAdj(n, uu, vv);
+        cout << "compressed adjacency: " << adj.bytes() << " bytes" << endl;
+    }
+    prof.phase("kernel");
     // vector<double> cn(m), sa(m), jc(m), hp(m), hd(m), si(m), li(m), aa(m), ra(m), pa(m), fm(m), dl(m);
     vector<double> lp(m);
     int edge_count = 0;
@@ -141,36 +140,54 @@ int main(int argc, char *argv[]) {
     //             LP_uv += epsilon
     //     LP_list.append(LP_uv)
     double epsilon = 0.001;
-    parallel_for(m, [&](int start, int end) {
-        for (auto i = start; i < end; ++i) {
-            mut_n.lock();
-            cout << "\r" << edge_count++ << "/" << m << flush;
-            mut_n.unlock();
-            auto u_i = uu[i];
-            auto v_i = vv[i];
-            auto &N_u = v2Nv[u_i];
-            auto &N_v = v2Nv[v_i];
-            int d_u = N_u.size();
-            int d_v = N_v.size();
-            double dd_u = (double)d_u;
-            double dd_v = (double)d_v;
-            vector<int> intersect;
-            intersect.reserve(min(d_u, d_v));
-            set_intersection(N_u.begin(), N_u.end(), N_v.begin(), N_v.end(),
-                             back_inserter(intersect));
-            double cn_i = (double)intersect.size();
-            double lp_i = 1. + cn_i;
-            for (auto x: N_u) {
-                for (auto y: N_v) {
-                    if (x == y) continue;
-                    if (v2Nv[x].contains(y)) lp_i += epsilon;
-                }
-            }
-            mut_m.lock();
-            lp[i] = lp_i;
-            mut_m.unlock();
-        }
+    // the LP of an edge is 1 + CN plus epsilon times the number of paths u - x - y - v with x in N(u) and
+    // y in N(x) & N(v) (count_paths of edge_kernels.h)
+    auto paths_of = [&](int u_i, int v_i, int start, int end) {
+        return compressed ? count_paths(adj, u_i, v_i, start, end) : count_paths(v2Nv, u_i, v_i, start, end);
+    };
+    auto degree = [&](int x) { return compressed ? adj.degree(x) : (int)v2Nv[x].size(); };
+    // edge (u, v) costs about d_u * d_v; the edges are taken by decreasing cost, and those above heavy_share
+    // of the total cost per thread (hub-hub edges) are each split across all the threads
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+    const double heavy_share = 1. / 16;
+    vector<double> edge_cost(m);
+    for (auto i = 0; i < m; ++i) {
+        edge_cost[i] = (double)degree(uu[i]) * (double)degree(vv[i]) + degree(uu[i]) + degree(vv[i]);
+    }
+    double heavy_threshold = max(accumulate(edge_cost.begin(), edge_cost.end(), 0.) / nb_threads * heavy_share, 1e6);
+    vector<int> order(m);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int i, int j) { return edge_cost[i] > edge_cost[j]; });
+    int n_heavy = 0;
+    while (n_heavy < m && edge_cost[order[n_heavy]] > heavy_threshold) ++n_heavy;
+    if (n_heavy > 0) cout << "split " << n_heavy << " heavy edges across the threads" << endl;
+    // the slices of all the heavy edges go through one dynamic pool, the most expensive edges first
+    auto slices = slice_edges(vector<int>(order.begin(), order.begin() + n_heavy), uu, vv, degree, (int)nb_threads);
+    vector<long long> slice_paths(slices.size(), 0);
+    parallel_for_dynamic(slices.size(), [&](int k) {
+        Profiler::thread_enter();
+        slice_paths[k] = paths_of(slices[k].u, slices[k].v, slices[k].start, slices[k].end);
     });
+    vector<long long> paths(m, 0);
+    for (size_t k = 0; k < slices.size(); ++k) paths[slices[k].edge] += slice_paths[k];
+    parallel_for_dynamic(m, [&](int t) {
+        Profiler::thread_enter();
+        int i = order[t];
+        mut_n.lock();
+        cout << "\r" << edge_count++ << "/" << m << flush;
+        mut_n.unlock();
+        auto u_i = uu[i];
+        auto v_i = vv[i];
+        long long cn_i = compressed ? count_common(adj, u_i, v_i) : count_common(v2Nv, u_i, v_i);
+        long long paths_i = paths[i];
+        if (t >= n_heavy) paths_i = paths_of(u_i, v_i, 0, degree(u_i));
+        double lp_i = 1. + (double)cn_i + (double)paths_i * epsilon;
+        mut_m.lock();
+        lp[i] = lp_i;
+        mut_m.unlock();
+    });
+    prof.phase("output");
     ofstream fout;
     string outfile = "data/metrics_cpp/" + dataset_full + "_lp.txt";
     fout.open(outfile.c_str());
@@ -178,5 +195,23 @@ int main(int argc, char *argv[]) {
         fout << x << endl;
     }
     fout.close();
+    prof.finish();
+    if (profile) {
+        // the kernel reads about d_u + d_v neighbors for the intersection and d_u * d_v for the paths (plus the lookups)
+        double entries = 0.;
+        for (auto i = 0; i < m; ++i) entries += edge_cost[i];
+        // a std::set entry is a tree node (3 pointers, the color and the int)
+        double adjacency_bytes = compressed ? (double)adj.bytes() : 2. * m * 40. + (double)n * sizeof(set<int>);
+        double edges = max((double)m, 1.), cache_misses = prof.counter("kernel", "cache_misses");
+        std::filesystem::create_directories("data/profile");
+        prof.write_json("data/profile/" + dataset_full + "_local_path.json", "local_path", dataset, {
+            {"edges", (double)m},
+            {"edges_per_second", m / prof.seconds("kernel")},
+            {"adjacency_bytes", adjacency_bytes},
+            {"adjacency_entries_per_edge", entries / edges},
+            {"adjacency_bytes_per_edge", entries / edges * adjacency_bytes / (2. * m)},
+            {"cache_miss_bytes_per_edge", cache_misses < 0 ? NAN : cache_misses * 64. / edges},
+        });
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// combines the outputs of "cn_pairs <dataset> --shard i/N" or "metrics <dataset> --shard i/N", i = 0, ..., N - 1,
+// into the files a single unsharded run would have written
+// with N = 1 the programs already write the unsharded files, which are only checked (pairs or edges) here
+// usage: ./merge_shards cn_pairs|metrics <dataset> <N>
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        cerr << "usage: " << argv[0] << " cn_pairs|metrics <dataset> <N>" << endl;
+        return 1;
+    }
+    string task(argv[1]);
+    string dataset(argv[2]);
+    int n_shards = atoi(argv[3]);
+    if (n_shards <= 0) {
+        throw invalid_argument("the number of shards must be positive");
+    }
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument("unknown dataset");
+    }
+
+    // the suffix rule of cn_pairs.cpp and metrics.cpp
+    auto shard_suffix = [&](int shard) {
+        return n_shards > 1 ? ".shard" + to_string(shard) + "of" + to_string(n_shards) + ".txt" : ".txt";
+    };
+    auto open_shard = [&](ifstream &fin, const string &infile) {
+        fin.open(infile.c_str());
+        if (!fin.is_open()) {
+            throw runtime_error("missing shard output " + infile);
+        }
+    };
+    if (task == "cn_pairs") {
+        // the partial histograms are summed, and together cover the n (n - 1) / 2 pairs
+        map<int, long long> cn2p;
+        long long pairs = 0;
+        for (int shard = 0; shard < n_shards; ++shard) {
+            ifstream fin;
+            open_shard(fin, "data/numberOfCN2numberOfPairs_cpp/" + dataset_full + shard_suffix(shard));
+            int cn;
+            long long p;
+            while (fin >> cn >> p) {
+                cn2p[cn] += p;
+                pairs += p;
+            }
+            fin.close();
+        }
+        if (pairs != (long long)n * (n - 1) / 2) {
+            throw runtime_error(to_string(pairs) + " pairs merged, expected " + to_string((long long)n * (n - 1) / 2));
+        }
+        if (n_shards == 1) return 0;
+        ofstream fout;
+        string outfile = "data/numberOfCN2numberOfPairs_cpp/" + dataset_full + ".txt";
+        fout.open(outfile.c_str());
+        for (auto const &x: cn2p) {
+            fout << x.first << ' ' << x.second << endl;
+        }
+        fout.close();
+    } else if (task == "metrics") {
+        // the shards hold consecutive edge ranges, so each metric column is a concatenation
+        vector<string> metrics = {"cn", "sa", "jc", "hp", "hd", "si", "li", "aa", "ra", "pa", "fm", "dl"};
+        for (auto &metric : metrics) {
+            ofstream fout;
+            string outfile = "data/metrics_cpp/" + dataset_full + "_" + metric + ".txt";
+            // the single shard is the output itself
+            if (n_shards > 1) fout.open(outfile.c_str());
+            int lines = 0;
+            for (int shard = 0; shard < n_shards; ++shard) {
+                ifstream fin;
+                open_shard(fin, "data/metrics_cpp/" + dataset_full + "_" + metric + shard_suffix(shard));
+                string line;
+                while (getline(fin, line)) {
+                    if (n_shards > 1) fout << line << '\n';
+                    ++lines;
+                }
+                fin.close();
+            }
+            if (n_shards > 1) fout.close();
+            if (lines != m) {
+                throw runtime_error(outfile + ": " + to_string(lines) + " edges merged, expected " + to_string(m));
+            }
+        }
+    } else {
+        throw invalid_argument("unknown task");
+    }
+    return 0;
+}
@@ -1,7 +1,9 @@
 #include <math.h>
 #include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <cassert>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
@@ -20,59 +22,42 @@
 #include <unordered_set>
 #include <vector>
 
+#include "checkpoint.h"
+#include "compressed_adj.h"
+#include "edge_kernels.h"
+#include "edge_metrics.h"
+#include "perf_profile.h"
+
 using namespace std;
 mutex mut_m, mut_n;
 
-/// @param[in] nb_elements : size of your for loop
-/// @param[in] functor(start, end) :
-/// your function processing a sub chunk of the for loop.
-/// "start" is the first index to process (included) until the index "end"
-/// (excluded)
-/// @code
-///     for(int i = start; i < end; ++i)
-///         computation(i);
-/// @endcode
-/// @param use_threads : enable / disable threads.
-///
-///
-static void parallel_for(unsigned nb_elements,
-                         function<void(int start, int end)> functor,
-                         bool use_threads = true) {
-    // -------
-    unsigned nb_threads_hint = thread::hardware_concurrency();
-    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
-
-    unsigned batch_size = nb_elements / nb_threads;
-    unsigned batch_remainder = nb_elements % nb_threads;
-
-    vector<thread> my_threads(nb_threads);
-
-    if (use_threads) {
-        // Multithread execution
-        for (unsigned i = 0; i < nb_threads; ++i) {
-            int start = i * batch_size;
-            my_threads[i] = std::thread(functor, start, start + batch_size);
-        }
-    } else {
-        // Single thread execution (for easy debugging)
-        for (unsigned i = 0; i < nb_threads; ++i) {
-            int start = i * batch_size;
-            functor(start, start + batch_size);
-        }
-    }
-
-    // Deform the elements left
-    int start = nb_threads * batch_size;
-    functor(start, start + batch_remainder);
-
-    // Wait for the other thread to finish their task
-    if (use_threads)
-        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
-}
-
 int main(int argc, char *argv[]) {
     std::filesystem::create_directories("data/metrics_cpp");
     string dataset(argv[1]);
+    // optional "--shard i/N": only the i-th (0-based) of N slices of the edges, balanced by estimated cost
+    // optional "--resume": skip the chunks finished by a previous run, read from its checkpoint
+    // optional "--checkpoint-interval s": seconds between checkpoint writes (default 300, 0 disables)
+    // optional "--compressed": keep the neighbor lists delta + varint encoded (compressed_adj.h) instead of in sets
+    // optional "--profile": hardware counters per phase (perf_profile.h), reported to data/profile/<name>_metrics.json
+    int shard = 0, n_shards = 1;
+    bool resume = false, compressed = false, profile = false;
+    double checkpoint_interval = 300.;
+    for (int a = 2; a < argc; ++a) {
+        if (string(argv[a]) == "--shard" && a + 1 < argc) {
+            sscanf(argv[++a], "%d/%d", &shard, &n_shards);
+        } else if (string(argv[a]) == "--resume") {
+            resume = true;
+        } else if (string(argv[a]) == "--checkpoint-interval" && a + 1 < argc) {
+            checkpoint_interval = atof(argv[++a]);
+        } else if (string(argv[a]) == "--compressed") {
+            compressed = true;
+        } else if (string(argv[a]) == "--profile") {
+            profile = true;
+        }
+    }
+    if (n_shards < 1 || shard < 0 || shard >= n_shards) {
+        throw invalid_argument("invalid shard");
+    }
     string dataset_full;
     int n, m;
     if (dataset == "OF") {
@@ -111,9 +96,11 @@ int main(int argc, char *argv[]) {
     } else {
         throw invalid_argument( "unknown dataset");
     }
+    Profiler prof(profile);
+    prof.phase("load");
     string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
     ifstream fin;
-    vector<set<int>> v2Nv(n);
+    vector<set<int>> v2Nv(compressed ? 0 : n);
     vector<int> uu, vv;
     uu.reserve(m);
     vv.reserve(m);
@@ -121,172 +108,210 @@ int main(int argc, char *argv[]) {
     int u, v;
     for (auto i = 0; i < m; ++i) {
         fin >> u >> v;
-        v2Nv[u].insert(v);
-        v2Nv[v].insert(u);
         uu.push_back(u);
         vv.push_back(v);
     }
     fin.close();
-    vector<double> cn(m), sa(m), jc(m), hp(m), hd(m), si(m), li(m), aa(m), ra(m), pa(m), fm(m), dl(m);
-    int edge_count = 0;
-    parallel_for(m, [&](int start, int end) {
-        for (auto i = start; i < end; ++i) {
-            mut_n.lock();
-            cout << "\r" << edge_count++ << "/" << m << flush;
-            mut_n.unlock();
-            auto u_i = uu[i];
-            auto v_i = vv[i];
-            auto &N_u = v2Nv[u_i];
-            auto &N_v = v2Nv[v_i];
-            int d_u = N_u.size();
-            int d_v = N_v.size();
-            double dd_u = (double)d_u;
-            double dd_v = (double)d_v;
-            vector<int> intersect;
-            intersect.reserve(min(d_u, d_v));
-            set_intersection(N_u.begin(), N_u.end(), N_v.begin(), N_v.end(),
-                             back_inserter(intersect));
-            // name2metric['CN'] = cn_uv
-            double cn_i = (double)intersect.size();
-            // name2metric['SA'] = cn_uv / math.sqrt(du * dv)
-            double sa_i = cn_i / sqrt(dd_u * dd_v);
-            // name2metric['JC'] = cn_uv / (du + dv - cn_uv)
-            double jc_i = cn_i / (dd_u + dd_v - cn_i);
-            // name2metric['HP'] = cn_uv / min(du, dv)
-            double hp_i = cn_i / min(dd_u, dd_v);
-            // name2metric['HD'] = cn_uv / max(du, dv)
-            double hd_i = cn_i / max(dd_u, dd_v);
-            // name2metric['SI'] = cn_uv / (du + dv)
-            double si_i = cn_i / (dd_u + dd_v);
-            // name2metric['LI'] = cn_uv / (du * dv)
-            double li_i = cn_i / (dd_u * dd_v);
-            // for x in CN_uv:
-            //     name2metric['AA'] += 1 / math.log(degrees[x])
-            //     name2metric['RA'] += 1 / degrees[x]
-            double aa_i = 0., ra_i = 0.;
-            for (auto x : intersect) {
-                double dd_x = (double)v2Nv[x].size();
-                aa_i += 1 / log(dd_x);
-                ra_i += 1 / dd_x;
-            }
-            // name2metric['PA'] = du * dv
-            double pa_i = dd_u * dd_v;
-            // name2metric['FM'] = cn_uv
-            // for x, y in product(Nu - Nv, Nv - Nu):
-            //     if y in neighbors_list[x]:
-            //         name2metric['FM'] += 1
-            double fm_i = 0.;
-            for (auto x : N_u) {
-                for (auto y : N_v) {
-                    if (x == y || v2Nv[x].contains(y)) {
-                        fm_i += 1.;
-                    }
-                }
+    prof.phase("adjacency build");
+    if (!compressed) {
+        for (auto i = 0; i < m; ++i) {
+            v2Nv[uu[i]].insert(vv[i]);
+            v2Nv[vv[i]].insert(uu[i]);
+        }
+    }
+    CompressedAdj adj;
+    if (compressed) {
+        adj = CompressedAdj(n, uu, vv);
+        cout << "compressed adjacency: " << adj.bytes() << " bytes" << endl;
+    }
+    auto degree = [&](int x) { return compressed ? adj.degree(x) : (int)v2Nv[x].size(); };
+    prof.phase("kernel");
+    vector<double> edge_cost = compressed ? edge_costs(adj, uu, vv) : edge_costs(v2Nv, uu, vv);
+    vector<int> bounds = balanced_split(edge_cost, n_shards);
+    int edge_lo = bounds[shard], edge_hi = bounds[shard + 1];
+    int m_shard = edge_hi - edge_lo;
+    vector<double> cn(m_shard), sa(m_shard), jc(m_shard), hp(m_shard), hd(m_shard), si(m_shard), li(m_shard),
+            aa(m_shard), ra(m_shard), pa(m_shard), fm(m_shard), dl(m_shard);
+    vector<double> *columns[] = {&cn, &sa, &jc, &hp, &hd, &si, &li, &aa, &ra, &pa, &fm, &dl};
+    const int n_columns = 12;
+    // the edges of the shard are processed (and checkpointed) in chunks of about equal cost
+    const int n_chunks = 1024;
+    vector<int> chunk_bounds = balanced_split(vector<double>(edge_cost.begin() + edge_lo, edge_cost.begin() + edge_hi), n_chunks);
+    string shard_name = n_shards > 1 ? ".shard" + to_string(shard) + "of" + to_string(n_shards) : "";
+    std::filesystem::create_directories("data/checkpoint");
+    Checkpointer ckpt("data/checkpoint/" + dataset_full + "_metrics" + shard_name + ".ckpt",
+                      checkpoint_key(edge_input, n, m, shard, n_shards, edge_lo, edge_hi, chunk_bounds), n_chunks,
+                      checkpoint_interval);
+    vector<bool> chunk_done(n_chunks, false);
+    if (resume) {
+        // a chunk payload is its slice of each column, one column after another
+        auto valid_size = [&](int chunk, long long size) {
+            return size == (long long)sizeof(double) * n_columns * (chunk_bounds[chunk + 1] - chunk_bounds[chunk]);
+        };
+        for (auto &[chunk, payload] : ckpt.load(valid_size)) {
+            chunk_done[chunk] = true;
+            int lo = chunk_bounds[chunk], len = chunk_bounds[chunk + 1] - lo;
+            auto *rec = (const double *)payload.data();
+            for (int j = 0; j < n_columns; ++j) {
+                copy(rec + (size_t)j * len, rec + (size_t)(j + 1) * len, columns[j]->begin() + lo);
             }
-            // name2metric['DL'] = du + dv - 2
-            double dl_i = dd_u + dd_v - 2;
-            mut_m.lock();
-            // vector<double> cn(m), sa(m), jc(m), hp(m), hd(m), si(m), li(m), aa(m), ra(m), pa(m), fm(m), dl(m);
-            cn[i] = cn_i;
-            sa[i] = sa_i;
-            jc[i] = jc_i;
-            hp[i] = hp_i;
-            hd[i] = hd_i;
-            si[i] = si_i;
-            li[i] = li_i;
-            aa[i] = aa_i;
-            ra[i] = ra_i;
-            pa[i] = pa_i;
-            fm[i] = fm_i;
-            dl[i] = dl_i;
-            mut_m.unlock();
         }
-    });
-
+    }
+    vector<int> todo;
+    for (int chunk = 0; chunk < n_chunks; ++chunk) {
+        if (!chunk_done[chunk]) todo.push_back(chunk);
+    }
+    int edge_count = 0;
+    auto on_heavy = [&](int n_heavy) {
+        if (n_heavy > 0) cout << "split " << n_heavy << " heavy edges across the threads" << endl;
+        ckpt.start();
+    };
+    auto on_edge = [&](int i, const EdgeMetrics &r) {
+        mut_n.lock();
+        cout << "\r" << edge_count++ << "/" << m_shard << flush;
+        mut_n.unlock();
+        mut_m.lock();
+        // vector<double> cn(m), sa(m), jc(m), hp(m), hd(m), si(m), li(m), aa(m), ra(m), pa(m), fm(m), dl(m);
+        cn[i - edge_lo] = r.cn;
+        sa[i - edge_lo] = r.sa;
+        jc[i - edge_lo] = r.jc;
+        hp[i - edge_lo] = r.hp;
+        hd[i - edge_lo] = r.hd;
+        si[i - edge_lo] = r.si;
+        li[i - edge_lo] = r.li;
+        aa[i - edge_lo] = r.aa;
+        ra[i - edge_lo] = r.ra;
+        pa[i - edge_lo] = r.pa;
+        fm[i - edge_lo] = r.fm;
+        dl[i - edge_lo] = r.dl;
+        mut_m.unlock();
+    };
+    auto on_chunk = [&](int chunk) {
+        int lo = chunk_bounds[chunk], len = chunk_bounds[chunk + 1] - lo;
+        vector<char> payload(sizeof(double) * n_columns * len);
+        auto *rec = (double *)payload.data();
+        for (int j = 0; j < n_columns; ++j) {
+            copy(columns[j]->begin() + lo, columns[j]->begin() + lo + len, rec + (size_t)j * len);
+        }
+        ckpt.add(chunk, std::move(payload));
+    };
+    // the FM of the heavy edges split across the threads, then the chunks by decreasing cost (edge_metrics.h)
+    if (compressed) {
+        schedule_edge_metrics(adj, uu, vv, edge_cost, edge_lo, chunk_bounds, todo, on_heavy, on_edge, on_chunk);
+    } else {
+        schedule_edge_metrics(v2Nv, uu, vv, edge_cost, edge_lo, chunk_bounds, todo, on_heavy, on_edge, on_chunk);
+    }
+    prof.phase("output");
 
+    // the columns of a shard only cover its edges, merge_shards concatenates them
+    string suffix = n_shards > 1 ? ".shard" + to_string(shard) + "of" + to_string(n_shards) + ".txt" : ".txt";
     ofstream fout;
-    string outfile = "data/metrics_cpp/" + dataset_full + "_cn.txt";
+    string outfile = "data/metrics_cpp/" + dataset_full + "_cn" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : cn) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_sa.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_sa" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : sa) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_jc.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_jc" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : jc) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_hp.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_hp" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : hp) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_hd.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_hd" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : hd) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_si.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_si" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : si) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_li.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_li" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : li) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_aa.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_aa" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : aa) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_ra.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_ra" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : ra) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_pa.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_pa" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : pa) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_fm.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_fm" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : fm) {
         fout << x << endl;
     }
     fout.close();
 
-    outfile = "data/metrics_cpp/" + dataset_full + "_dl.txt";
+    outfile = "data/metrics_cpp/" + dataset_full + "_dl" + suffix;
     fout.open(outfile.c_str());
     for (auto &x : dl) {
         fout << x << endl;
     }
     fout.close();
+    prof.finish();
+    if (profile) {
+        // the kernel reads about d_u + d_v neighbors for the intersection and d_u * d_v for FM (plus the lookups)
+        double entries = 0.;
+        for (auto chunk : todo) {
+            for (auto i = edge_lo + chunk_bounds[chunk]; i < edge_lo + chunk_bounds[chunk + 1]; ++i) {
+                double dd_u = (double)degree(uu[i]), dd_v = (double)degree(vv[i]);
+                entries += dd_u + dd_v + dd_u * dd_v;
+            }
+        }
+        // a std::set entry is a tree node (3 pointers, the color and the int)
+        double adjacency_bytes = compressed ? (double)adj.bytes() : 2. * m * 40. + (double)n * sizeof(set<int>);
+        double edges = max((double)edge_count, 1.), cache_misses = prof.counter("kernel", "cache_misses");
+        std::filesystem::create_directories("data/profile");
+        prof.write_json("data/profile/" + dataset_full + "_metrics" + shard_name + ".json", "metrics", dataset, {
+            {"edges", (double)edge_count},
+            {"edges_per_second", edge_count / prof.seconds("kernel")},
+            {"adjacency_bytes", adjacency_bytes},
+            {"adjacency_entries_per_edge", entries / edges},
+            {"adjacency_bytes_per_edge", entries / edges * adjacency_bytes / (2. * m)},
+            {"cache_miss_bytes_per_edge", cache_misses < 0 ? NAN : cache_misses * 64. / edges},
+        });
+    }
+    ckpt.finish(true);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,414 @@
+#include <math.h>
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+
+using namespace std;
+mutex mut_m, mut_n;
+
+// the per-edge metrics of metrics.cpp, maintained under a stream of edge insertions and deletions
+// the updates file holds one command per line:
+// - "+ u v": insert the edge (u, v) (new node ids are allowed)
+// - "- u v": delete the edge (u, v)
+// - "dump": write the current edges and metrics (also done at the end of the stream)
+// the updates are applied in batches of --batch-size commands (a batch also ends at a "dump"); within a batch,
+// an insertion and a deletion of the same edge cancel out, and the remaining changes are applied one by one
+// usage: ./metrics_dynamic <dataset> <updates file> [--batch-size b]
+//
+// CN, AA, RA and FM are stored per edge and updated by the changes that a single edge (a, b) makes,
+// with N() the neighborhoods without (a, b) and s = +1 for an insertion, -1 for a deletion:
+// - CN: the edges (a, x) and (b, x) for x in N(a) & N(b) get s, and AA/RA the term of b (resp. a) at its degree with (a, b)
+// - AA/RA: the edges inside N(a) (resp. N(b)) replace the term of a (resp. b) at the old degree by the one at the new degree
+// - FM = CN + the number of 3-walks u - x - y - v (x in N(u), y in N(v), x ~ y); the new 3-walks through (a, b) are
+//   |N(b) & N(x)| + 1 for the edge (a, x), |N(a) & N(x)| + 1 for (b, x),
+//   and one per orientation (x in N(a), y in N(b)) for the other edges (x, y)
+// so a change costs about sum_{x in N(a)} min(d_x, d_b) + sum_{x in N(b)} min(d_x, d_a) set lookups, not a pass over the m edges
+// the metrics that only depend on CN and the degrees (SA, JC, HP, HD, SI, LI, PA, DL) are derived when dumping
+// the dumps are data/metrics_cpp/<name>_dynamic.edge_txt (the current edges, in insertion order)
+// and data/metrics_cpp/<name>_dynamic_<metric>.txt (one line per edge, as metrics.cpp)
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// reads "u v" (an optional weight column is skipped)
+static bool read_edge(ifstream &fin, int &u, int &v) {
+    if (!(fin >> u >> v)) return false;
+    fin.ignore(numeric_limits<streamsize>::max(), '\n');
+    return true;
+}
+
+class DynamicMetrics {
+public:
+    struct Stats {
+        long long applied = 0, skipped = 0, touched = 0;
+    };
+
+    DynamicMetrics(int n, const vector<int> &uu0, const vector<int> &vv0) : v2Nv(n) {
+        for (size_t i = 0; i < uu0.size(); ++i) {
+            int u = uu0[i], v = vv0[i];
+            if (u == v || pair2edge.count(key(u, v))) continue;
+            v2Nv[u].insert(v);
+            v2Nv[v].insert(u);
+            new_slot(u, v);
+        }
+        // the initial values, as in metrics.cpp
+        parallel_for(uu.size(), [&](int start, int end) {
+            for (auto i = start; i < end; ++i) {
+                compute(i);
+            }
+        });
+    }
+
+    // applies a batch of (+1 / -1, u, v) changes
+    Stats apply_batch(const vector<tuple<int, int, int>> &batch) {
+        Stats stats;
+        // the last command on each edge wins; it is a change only if it differs from the current state
+        map<long long, tuple<int, int, int>> net;
+        for (auto &c : batch) {
+            auto [s, u, v] = c;
+            if (u == v || u < 0 || v < 0) {
+                ++stats.skipped;
+                continue;
+            }
+            net[key(u, v)] = c;
+        }
+        stats.skipped += (long long)batch.size() - stats.skipped - (long long)net.size();
+        for (auto &[k, c] : net) {
+            auto [s, u, v] = c;
+            ensure_node(max(u, v));
+            bool present = pair2edge.count(k) > 0;
+            if ((s > 0) == present) {
+                ++stats.skipped;
+                continue;
+            }
+            stats.touched += toggle(u, v, s);
+            ++stats.applied;
+        }
+        return stats;
+    }
+
+    // writes the current edges and the 12 metrics of metrics.cpp
+    void dump(const string &prefix) const {
+        ofstream fout((prefix + ".edge_txt").c_str());
+        vector<int> alive;
+        for (int i = 0; i < (int)uu.size(); ++i) {
+            if (uu[i] < 0) continue;
+            alive.push_back(i);
+            fout << uu[i] << " " << vv[i] << endl;
+        }
+        fout.close();
+        const char *names[] = {"cn", "sa", "jc", "hp", "hd", "si", "li", "aa", "ra", "pa", "fm", "dl"};
+        for (int j = 0; j < 12; ++j) {
+            fout.open((prefix + "_" + names[j] + ".txt").c_str());
+            for (auto i : alive) {
+                double dd_u = (double)v2Nv[uu[i]].size(), dd_v = (double)v2Nv[vv[i]].size();
+                double cn_i = cn[i], x;
+                switch (j) {
+                    case 0: x = cn_i; break;
+                    case 1: x = cn_i / sqrt(dd_u * dd_v); break;
+                    case 2: x = cn_i / (dd_u + dd_v - cn_i); break;
+                    case 3: x = cn_i / min(dd_u, dd_v); break;
+                    case 4: x = cn_i / max(dd_u, dd_v); break;
+                    case 5: x = cn_i / (dd_u + dd_v); break;
+                    case 6: x = cn_i / (dd_u * dd_v); break;
+                    case 7: x = aa[i]; break;
+                    case 8: x = ra[i]; break;
+                    case 9: x = dd_u * dd_v; break;
+                    case 10: x = fm[i]; break;
+                    default: x = dd_u + dd_v - 2; break;
+                }
+                fout << x << endl;
+            }
+            fout.close();
+        }
+    }
+
+    long long n_edges() const { return (long long)pair2edge.size(); }
+
+private:
+    long long key(int u, int v) const { return ((long long)min(u, v) << 32) | (unsigned)max(u, v); }
+
+    int edge(int u, int v) const { return pair2edge.at(key(u, v)); }
+
+    void ensure_node(int x) {
+        if (x >= (int)v2Nv.size()) v2Nv.resize(x + 1);
+    }
+
+    int new_slot(int u, int v) {
+        int i = (int)uu.size();
+        pair2edge[key(u, v)] = i;
+        uu.push_back(u);
+        vv.push_back(v);
+        cn.push_back(0.);
+        aa.push_back(0.);
+        ra.push_back(0.);
+        fm.push_back(0.);
+        return i;
+    }
+
+    // calls f(y) for every y in N(x) & N(z), looking up the smaller set in the larger one
+    template <class F>
+    void for_each_common(int x, int z, F f) const {
+        const set<int> *small = &v2Nv[x], *large = &v2Nv[z];
+        if (small->size() > large->size()) swap(small, large);
+        for (auto y : *small) {
+            if (large->count(y)) f(y);
+        }
+    }
+
+    long long common_size(int x, int z) const {
+        long long res = 0;
+        for_each_common(x, z, [&](int) { ++res; });
+        return res;
+    }
+
+    // from scratch, with the current neighborhoods
+    void compute(int i) {
+        int u_i = uu[i], v_i = vv[i];
+        double cn_i = 0., aa_i = 0., ra_i = 0.;
+        for_each_common(u_i, v_i, [&](int x) {
+            double dd_x = (double)v2Nv[x].size();
+            cn_i += 1.;
+            aa_i += 1 / log(dd_x);
+            ra_i += 1 / dd_x;
+        });
+        // the count of metrics.cpp: x == y for the CNs, and y in N(x) for |N(x) & N(v)| of each x
+        double fm_i = cn_i;
+        for (auto x : v2Nv[u_i]) {
+            fm_i += (double)common_size(x, v_i);
+        }
+        cn[i] = cn_i, aa[i] = aa_i, ra[i] = ra_i, fm[i] = fm_i;
+    }
+
+    // inserts (s = 1) or deletes (s = -1) the edge (a, b); returns the number of edge updates made
+    long long toggle(int a, int b, int s) {
+        long long touched = 0;
+        if (s < 0) {
+            // the deltas below are taken on the graph without (a, b)
+            int i = edge(a, b);
+            pair2edge.erase(key(a, b));
+            uu[i] = vv[i] = -1;
+            v2Nv[a].erase(b);
+            v2Nv[b].erase(a);
+        }
+        const set<int> &N_a = v2Nv[a], &N_b = v2Nv[b];
+        double d_a = (double)N_a.size(), d_b = (double)N_b.size();
+        // AA/RA: a (resp. b) is a CN of the edges inside its neighborhood, and its degree goes from d to d + 1
+        for (int c : {a, b}) {
+            const set<int> &N_c = v2Nv[c];
+            double dd_lo = (double)N_c.size(), dd_hi = dd_lo + 1.;
+            double d_aa = s * (1 / log(dd_hi) - 1 / log(dd_lo)), d_ra = s * (1 / dd_hi - 1 / dd_lo);
+            for (auto x : N_c) {
+                for_each_common(x, c, [&](int y) {
+                    if (x < y) {
+                        int i = edge(x, y);
+                        aa[i] += d_aa, ra[i] += d_ra;
+                        ++touched;
+                    }
+                });
+            }
+        }
+        // CN: b becomes a CN of (a, x) and a of (b, x) for every x in N(a) & N(b)
+        for_each_common(a, b, [&](int x) {
+            int i = edge(a, x), j = edge(b, x);
+            cn[i] += s, aa[i] += s / log(d_b + 1.), ra[i] += s / (d_b + 1.), fm[i] += s;
+            cn[j] += s, aa[j] += s / log(d_a + 1.), ra[j] += s / (d_a + 1.), fm[j] += s;
+            touched += 2;
+        });
+        // FM: the 3-walks through (a, b)
+        for (auto x : N_a) {
+            fm[edge(a, x)] += s * ((double)common_size(b, x) + 1.);
+            ++touched;
+            for_each_common(x, b, [&](int y) {
+                fm[edge(x, y)] += s;
+                ++touched;
+            });
+        }
+        for (auto x : N_b) {
+            fm[edge(b, x)] += s * ((double)common_size(a, x) + 1.);
+            ++touched;
+        }
+        if (s > 0) {
+            v2Nv[a].insert(b);
+            v2Nv[b].insert(a);
+            compute(new_slot(a, b));
+            ++touched;
+        }
+        return touched;
+    }
+
+    vector<set<int>> v2Nv;
+    unordered_map<long long, int> pair2edge;
+    // one slot per inserted edge; the slot of a deleted edge is kept with u = v = -1
+    vector<int> uu, vv;
+    vector<double> cn, aa, ra, fm;
+};
+
+int main(int argc, char *argv[]) {
+    std::filesystem::create_directories("data/metrics_cpp");
+    string dataset(argv[1]);
+    string updates_input(argv[2]);
+    int batch_size = 10000;
+    for (int a = 3; a < argc; ++a) {
+        string arg(argv[a]);
+        if (arg == "--batch-size" && a + 1 < argc) batch_size = max(1, atoi(argv[++a]));
+        else throw invalid_argument("unknown option " + arg);
+    }
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument("unknown dataset");
+    }
+
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    ifstream fin;
+    vector<int> uu, vv;
+    uu.reserve(m);
+    vv.reserve(m);
+    fin.open(edge_input.c_str());
+    int u, v;
+    for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+        uu.push_back(u);
+        vv.push_back(v);
+    }
+    fin.close();
+    auto t0 = chrono::steady_clock::now();
+    DynamicMetrics engine(n, uu, vv);
+    cout << "initial metrics: " << engine.n_edges() << " edges, "
+         << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+
+    string prefix = "data/metrics_cpp/" + dataset_full + "_dynamic";
+    fin.open(updates_input.c_str());
+    if (!fin.is_open()) throw invalid_argument("cannot open " + updates_input);
+    vector<tuple<int, int, int>> batch;
+    int n_batches = 0, n_dumps = 0;
+    auto flush_batch = [&]() {
+        if (batch.empty()) return;
+        auto t = chrono::steady_clock::now();
+        auto stats = engine.apply_batch(batch);
+        cout << "batch " << n_batches++ << ": " << stats.applied << " applied, " << stats.skipped << " skipped, "
+             << stats.touched << " edge updates, " << engine.n_edges() << " edges, "
+             << chrono::duration<double>(chrono::steady_clock::now() - t).count() << " s" << endl;
+        batch.clear();
+    };
+    string line;
+    while (getline(fin, line)) {
+        istringstream iss(line);
+        string op;
+        if (!(iss >> op)) continue;
+        if (op == "dump") {
+            flush_batch();
+            engine.dump(prefix);
+            ++n_dumps;
+            continue;
+        }
+        if ((op != "+" && op != "-") || !(iss >> u >> v)) {
+            throw invalid_argument("bad update line: " + line);
+        }
+        batch.emplace_back(op == "+" ? 1 : -1, u, v);
+        if ((int)batch.size() >= batch_size) flush_batch();
+    }
+    fin.close();
+    flush_batch();
+    engine.dump(prefix);
+    cout << "written " << prefix << "_*.txt (" << n_dumps + 1 << " dumps)" << endl;
+    return 0;
+}
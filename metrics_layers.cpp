@@ -0,0 +1,288 @@
+#include <math.h>
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+mutex mut_m, mut_n;
+
+// the per-edge metrics of metrics.cpp on every layer (the subgraph of the edges with weight >= l, l = 2, ..., 10)
+// in one pass over the weighted edge list
+// the neighbor lists are kept as weight-tagged CSR (sorted by node, with the weights capped at max_layer), and each
+// edge is traversed once for all layers: every common neighbor x, or every 2-hop pair (x, y) of FM, is counted in
+// the histogram of its threshold t (the smallest weight involved), and the value on layer l is the sum over t >= l
+// output: data/metrics_cpp/<name>_layer<l>_<metric>.txt with one line per edge of the full graph, "nan" for the
+// edges not in layer l
+// usage: ./metrics_layers <dataset> [max_layer (default 10)]
+const int n_metrics = 12;
+const char *metric_names[n_metrics] = {"cn", "sa", "jc", "hp", "hd", "si", "li", "aa", "ra", "pa", "fm", "dl"};
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// reads "u v w"
+static bool read_edge(ifstream &fin, int &u, int &v, int &w) {
+    if (!(fin >> u >> v >> w)) return false;
+    fin.ignore(numeric_limits<streamsize>::max(), '\n');
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::filesystem::create_directories("data/metrics_cpp");
+    string dataset(argv[1]);
+    int max_layer = argc > 2 ? atoi(argv[2]) : 10;
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument( "unknown dataset");
+    }
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    ifstream fin;
+    vector<int> uu, vv, ww;
+    uu.reserve(m);
+    vv.reserve(m);
+    ww.reserve(m);
+    fin.open(edge_input.c_str());
+    int u, v, w;
+    int w_max = 0;
+    for (auto i = 0; i < m && read_edge(fin, u, v, w); ++i) {
+        uu.push_back(u);
+        vv.push_back(v);
+        ww.push_back(min(w, max_layer));
+        w_max = max(w_max, w);
+    }
+    fin.close();
+    max_layer = min(max_layer, w_max);
+    // L = max_layer + 1 thresholds 0, ..., max_layer
+    const int L = max_layer + 1;
+
+    // weight-tagged CSR
+    vector<long long> offsets(n + 1, 0);
+    for (auto i = 0; i < m; ++i) {
+        ++offsets[uu[i] + 1];
+        ++offsets[vv[i] + 1];
+    }
+    partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    vector<pair<int, uint8_t>> nbrs(offsets[n]);
+    {
+        vector<long long> cursor(offsets.begin(), offsets.end() - 1);
+        for (auto i = 0; i < m; ++i) {
+            nbrs[cursor[uu[i]]++] = {vv[i], (uint8_t)ww[i]};
+            nbrs[cursor[vv[i]]++] = {uu[i], (uint8_t)ww[i]};
+        }
+    }
+    for (int x = 0; x < n; ++x) {
+        sort(nbrs.begin() + offsets[x], nbrs.begin() + offsets[x + 1]);
+    }
+    // deg[x * L + l]: the degree of x in layer l (l = 1 is the full graph)
+    vector<int> deg((size_t)n * L, 0);
+    for (int x = 0; x < n; ++x) {
+        for (long long k = offsets[x]; k < offsets[x + 1]; ++k) {
+            ++deg[(size_t)x * L + nbrs[k].second];
+        }
+        for (int l = L - 2; l >= 1; --l) deg[(size_t)x * L + l] += deg[(size_t)x * L + l + 1];
+    }
+
+    vector<ofstream> fout((size_t)L * n_metrics);
+    for (int l = 2; l < L; ++l) {
+        for (int j = 0; j < n_metrics; ++j) {
+            string outfile = "data/metrics_cpp/" + dataset_full + "_layer" + to_string(l) + "_" + metric_names[j] + ".txt";
+            fout[(size_t)l * n_metrics + j].open(outfile.c_str());
+        }
+    }
+
+    // the edges are processed in batches, whose rows (a metric value per layer) are then appended to the files
+    const int batch = 1 << 16;
+    vector<double> res((size_t)batch * L * n_metrics);
+    for (int b_lo = 0; b_lo < m; b_lo += batch) {
+        int b_len = min(batch, m - b_lo);
+        mut_n.lock();
+        cout << "\r" << b_lo << "/" << m << flush;
+        mut_n.unlock();
+        parallel_for(b_len, [&](int start, int end) {
+            vector<long long> cn_t(L), fm_t(L);
+            vector<double> aa_l(L), ra_l(L);
+            vector<pair<int, int>> common;
+            for (auto t_i = start; t_i < end; ++t_i) {
+                auto i = b_lo + t_i;
+                auto u_i = uu[i];
+                auto v_i = vv[i];
+                double *r = res.data() + (size_t)t_i * L * n_metrics;
+                fill(r, r + (size_t)L * n_metrics, numeric_limits<double>::quiet_NaN());
+                if (ww[i] < 2) continue;
+                fill(cn_t.begin(), cn_t.end(), 0);
+                fill(fm_t.begin(), fm_t.end(), 0);
+                fill(aa_l.begin(), aa_l.end(), 0.);
+                fill(ra_l.begin(), ra_l.end(), 0.);
+                common.clear();
+                auto N_u = nbrs.begin() + offsets[u_i], N_u_end = nbrs.begin() + offsets[u_i + 1];
+                auto N_v = nbrs.begin() + offsets[v_i], N_v_end = nbrs.begin() + offsets[v_i + 1];
+                // common neighbors x, present in the layers up to min(w_ux, w_vx)
+                for (auto a = N_u, b = N_v; a != N_u_end && b != N_v_end;) {
+                    if (a->first < b->first) ++a;
+                    else if (a->first > b->first) ++b;
+                    else {
+                        int t = min(a->second, b->second);
+                        common.emplace_back(a->first, t);
+                        ++cn_t[t];
+                        ++a, ++b;
+                    }
+                }
+                for (auto &[x, t] : common) {
+                    for (int l = 2; l <= t; ++l) {
+                        double dd_x = (double)deg[(size_t)x * L + l];
+                        aa_l[l] += 1 / log(dd_x);
+                        ra_l[l] += 1 / dd_x;
+                    }
+                }
+                // FM: x == y (the CNs), and y in N(x) & N(v) for x in N(u), present up to min(w_ux, w_xy, w_vy)
+                for (int t = 2; t < L; ++t) fm_t[t] += cn_t[t];
+                for (auto a = N_u; a != N_u_end; ++a) {
+                    if (a->second < 2) continue;
+                    int x = a->first;
+                    auto N_x = nbrs.begin() + offsets[x], N_x_end = nbrs.begin() + offsets[x + 1];
+                    for (auto c = N_x, b = N_v; c != N_x_end && b != N_v_end;) {
+                        if (c->first < b->first) ++c;
+                        else if (c->first > b->first) ++b;
+                        else {
+                            ++fm_t[min((int)a->second, (int)min(c->second, b->second))];
+                            ++c, ++b;
+                        }
+                    }
+                }
+                // suffix sums over the thresholds give the layer values
+                long long cn_l = 0, fm_l = 0;
+                for (int t = L - 1; t > ww[i]; --t) cn_l += cn_t[t], fm_l += fm_t[t];
+                for (int l = ww[i]; l >= 2; --l) {
+                    cn_l += cn_t[l];
+                    fm_l += fm_t[l];
+                    double dd_u = (double)deg[(size_t)u_i * L + l];
+                    double dd_v = (double)deg[(size_t)v_i * L + l];
+                    double cn_i = (double)cn_l;
+                    double *r_l = r + (size_t)l * n_metrics;
+                    r_l[0] = cn_i;
+                    r_l[1] = cn_i / sqrt(dd_u * dd_v);
+                    r_l[2] = cn_i / (dd_u + dd_v - cn_i);
+                    r_l[3] = cn_i / min(dd_u, dd_v);
+                    r_l[4] = cn_i / max(dd_u, dd_v);
+                    r_l[5] = cn_i / (dd_u + dd_v);
+                    r_l[6] = cn_i / (dd_u * dd_v);
+                    r_l[7] = aa_l[l];
+                    r_l[8] = ra_l[l];
+                    r_l[9] = dd_u * dd_v;
+                    r_l[10] = (double)fm_l;
+                    r_l[11] = dd_u + dd_v - 2;
+                }
+            }
+        });
+        for (int l = 2; l < L; ++l) {
+            for (int j = 0; j < n_metrics; ++j) {
+                auto &f = fout[(size_t)l * n_metrics + j];
+                for (int t_i = 0; t_i < b_len; ++t_i) {
+                    f << res[((size_t)t_i * L + l) * n_metrics + j] << '\n';
+                }
+            }
+        }
+    }
+    cout << endl;
+    for (auto &f : fout) {
+        if (f.is_open()) f.close();
+    }
+    return 0;
+}
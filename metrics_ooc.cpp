@@ -0,0 +1,383 @@
+#include <math.h>
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "adj_bin.h"
+
+using namespace std;
+mutex mut_m, mut_n;
+
+// number of per-edge metrics, in the order of the output files
+const int n_metrics = 12;
+const char *metric_names[n_metrics] = {"cn", "sa", "jc", "hp", "hd", "si", "li", "aa", "ra", "pa", "fm", "dl"};
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// edge record of the bucket files
+struct EdgeRec {
+    int i, u, v;
+};
+
+// usage: ./metrics_ooc <dataset> <memory budget in MB>
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <dataset> <memory budget in MB>" << endl;
+        return 1;
+    }
+    std::filesystem::create_directories("data/metrics_cpp");
+    std::filesystem::create_directories("data/adj_bin");
+    std::filesystem::create_directories("data/ooc_tmp");
+    string dataset(argv[1]);
+    // memory budget in MB
+    long long budget = (long long)(atof(argv[2]) * (1 << 20));
+    string dataset_full;
+    int n, m;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112;
+    } else {
+        throw invalid_argument( "unknown dataset");
+    }
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    string adj_file = "data/adj_bin/" + dataset_full + ".adj";
+    string tmp_prefix = "data/ooc_tmp/" + dataset_full;
+
+    // always resident, per node: the degree (4 bytes), the offset (8), the block (4) and at most one block bound (8);
+    // plus the buffers of the open files (up to 256 bucket files and the edge file while bucketing)
+    // the rest of the budget is split into five slots: in the FM pass the block of u, the block of the 2-hop neighbors
+    // and its transpose (two slots), in the second pass the blocks of u and v, and in both one slot for the edges processed together
+    long long resident = 24LL * (n + 1) + 257LL * BUFSIZ;
+    long long slot = (budget - resident) / 5;
+    long long max_chunk = slot / (long long)(sizeof(EdgeRec) + sizeof(double) * (n_metrics + 1));
+    if (slot <= 0 || max_chunk <= 0) {
+        throw invalid_argument("memory budget too small");
+    }
+
+    vector<int> deg(n, 0);
+    ifstream fin;
+    fin.open(edge_input.c_str());
+    int u, v;
+    for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+        ++deg[u];
+        ++deg[v];
+    }
+    fin.close();
+    vector<long long> offsets(n + 1, 0);
+    for (int x = 0; x < n; ++x) offsets[x + 1] = offsets[x] + deg[x];
+
+    // contiguous vertex blocks whose neighbor lists fit in one slot
+    vector<pair<int, int>> blocks;
+    vector<int> v2b(n);
+    for (int lo = 0; lo < n;) {
+        int hi = lo + 1;
+        while (hi < n && (offsets[hi + 1] - offsets[lo]) * (long long)sizeof(int) <= slot) ++hi;
+        if ((offsets[hi] - offsets[lo]) * (long long)sizeof(int) > slot) {
+            throw invalid_argument("memory budget too small for the neighbor list of node " + to_string(lo));
+        }
+        for (int x = lo; x < hi; ++x) v2b[x] = (int)blocks.size();
+        blocks.emplace_back(lo, hi);
+        lo = hi;
+    }
+    int k = (int)blocks.size();
+    cout << k << " blocks" << endl;
+    if (!adj_bin_valid(edge_input, adj_file, n, m, offsets)) {
+        build_adj_bin(edge_input, adj_file, n, m, deg, offsets, blocks);
+    }
+
+    // bucket the edges by the smaller block of their endpoints (at most 256 open files per pass),
+    // each bucket with a file of the 2-hop part of FM of its edges, in the same order
+    auto bucket_file = [&](int b) { return tmp_prefix + "_bucket" + to_string(b) + ".bin"; };
+    auto fm_file = [&](int b) { return tmp_prefix + "_bucket" + to_string(b) + "_fm.bin"; };
+    for (int g = 0; g < k; g += 256) {
+        vector<ofstream> fbucket(min(k, g + 256) - g);
+        vector<long long> count(fbucket.size(), 0);
+        for (int b = g; b < g + (int)fbucket.size(); ++b) {
+            fbucket[b - g].open(bucket_file(b).c_str(), ios::binary);
+        }
+        fin.open(edge_input.c_str());
+        for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+            int b = min(v2b[u], v2b[v]);
+            if (g <= b && b < g + (int)fbucket.size()) {
+                EdgeRec rec{i, u, v};
+                fbucket[b - g].write((const char *)&rec, sizeof(rec));
+                ++count[b - g];
+            }
+        }
+        fin.close();
+        for (int b = g; b < g + (int)fbucket.size(); ++b) {
+            fbucket[b - g].close();
+            ofstream ffm(fm_file(b).c_str(), ios::binary);
+            if (count[b - g] > 0) {
+                ffm.seekp(sizeof(double) * count[b - g] - 1);
+                ffm.put(0);
+            }
+        }
+    }
+
+    ifstream fadj(adj_file.c_str(), ios::binary);
+    long long base = adj_bin_base(fadj, n);
+    AdjBlock blk_i, blk_j, blk_k;
+    vector<EdgeRec> chunk;
+    vector<double> fm, res;
+    // reads the next chunk of bucket bi (with the matching values of its FM file), keeping the edges accepted by keep
+    auto read_chunk = [&](istream &fbucket, istream &ffm, function<bool(const EdgeRec &)> keep) {
+        chunk.clear();
+        fm.clear();
+        EdgeRec rec;
+        double fm_rec;
+        while ((long long)chunk.size() < max_chunk && fbucket.read((char *)&rec, sizeof(rec))) {
+            ffm.read((char *)&fm_rec, sizeof(fm_rec));
+            if (!keep(rec)) continue;
+            chunk.push_back(rec);
+            fm.push_back(fm_rec);
+        }
+        return !chunk.empty();
+    };
+
+    // first pass, the 2-hop part of FM: sum over x in N(u) of |N(x) & N(v)|, which is (by symmetry)
+    // the sum over y in N(v) of |N(y) & N(u)|, accumulated over the blocks bk of y
+    // with u the endpoint in block bi, the transpose of block bk (the pairs (v, y) with y in bk, sorted by v)
+    // gives N(v) & bk for every v, so the edges of bucket bi only need the blocks bi and bk to be resident
+    // and every block is loaded O(k) times
+    {
+        vector<pair<int, int>> transpose;
+        for (int bk = 0; bk < k; ++bk) {
+            load_block(fadj, base, offsets, blocks, bk, blk_k);
+            // sized exactly (8 bytes per entry of the block, its two slots): the previous buffer is released
+            // first, and emplace_back never grows the capacity past the budget
+            long long entries = offsets[blk_k.hi] - offsets[blk_k.lo];
+            if ((long long)transpose.capacity() < entries) {
+                vector<pair<int, int>>().swap(transpose);
+                transpose.reserve(entries);
+            }
+            transpose.clear();
+            for (int y = blk_k.lo; y < blk_k.hi; ++y) {
+                const int *N_y = blk_k.begin(offsets, y);
+                for (int t = 0; t < deg[y]; ++t) transpose.emplace_back(N_y[t], y);
+            }
+            sort(transpose.begin(), transpose.end());
+            for (int bi = 0; bi < k; ++bi) {
+                mut_n.lock();
+                cout << "\r" << "FM block pair " << bk << "-" << bi << "/" << k << flush;
+                mut_n.unlock();
+                ifstream fbucket(bucket_file(bi).c_str(), ios::binary);
+                fstream ffm(fm_file(bi).c_str(), ios::in | ios::out | ios::binary);
+                long long pos = 0;
+                while (read_chunk(fbucket, ffm, [](const EdgeRec &) { return true; })) {
+                    load_block(fadj, base, offsets, blocks, bi, blk_i);
+                    int c = (int)chunk.size();
+                    parallel_for(c, [&](int start, int end) {
+                        for (auto t = start; t < end; ++t) {
+                            int u_i = v2b[chunk[t].u] == bi ? chunk[t].u : chunk[t].v;
+                            int v_i = u_i == chunk[t].u ? chunk[t].v : chunk[t].u;
+                            const int *N_u = blk_i.begin(offsets, u_i);
+                            double fm_part = 0.;
+                            for (auto it = lower_bound(transpose.begin(), transpose.end(), make_pair(v_i, 0));
+                                 it != transpose.end() && it->first == v_i; ++it) {
+                                int y = it->second;
+                                fm_part += (double)intersection_size(blk_k.begin(offsets, y), deg[y], N_u, deg[u_i]);
+                            }
+                            fm[t] += fm_part;
+                        }
+                    });
+                    ffm.seekp(pos);
+                    ffm.write((const char *)fm.data(), sizeof(double) * c);
+                    pos += (long long)sizeof(double) * c;
+                    ffm.seekg(pos);
+                }
+            }
+        }
+    }
+    cout << endl;
+    unload_block(blk_k);
+
+    string res_file = tmp_prefix + "_metrics.bin";
+    {
+        // preallocate the per-edge results (m rows of n_metrics doubles) on disk
+        ofstream fres(res_file.c_str(), ios::binary);
+        fres.seekp(sizeof(double) * n_metrics * (long long)m - 1);
+        fres.put(0);
+    }
+    fstream fres(res_file.c_str(), ios::in | ios::out | ios::binary);
+    auto nbrs_of = [&](const AdjBlock &blk, int x) { return blk.begin(offsets, x); };
+    // the resident block holding node x among the two slots
+    auto block_of = [&](int x) -> const AdjBlock & { return blk_i.id == v2b[x] ? blk_i : blk_j; };
+
+    // second pass, all the metrics: the edges of bucket bi whose other endpoint is in block bj, block pair by block pair
+    for (int bi = 0; bi < k; ++bi) {
+        for (int bj = bi; bj < k; ++bj) {
+            mut_n.lock();
+            cout << "\r" << "block pair " << bi << "-" << bj << "/" << k << flush;
+            mut_n.unlock();
+            ifstream fbucket(bucket_file(bi).c_str(), ios::binary);
+            ifstream ffm(fm_file(bi).c_str(), ios::binary);
+            while (read_chunk(fbucket, ffm, [&](const EdgeRec &rec) { return max(v2b[rec.u], v2b[rec.v]) == bj; })) {
+                load_block(fadj, base, offsets, blocks, bi, blk_i);
+                if (bj != bi) load_block(fadj, base, offsets, blocks, bj, blk_j);
+                int c = (int)chunk.size();
+                res.assign((size_t)c * n_metrics, 0.);
+                parallel_for(c, [&](int start, int end) {
+                    for (auto t = start; t < end; ++t) {
+                        auto u_i = chunk[t].u;
+                        auto v_i = chunk[t].v;
+                        const int *N_u = nbrs_of(block_of(u_i), u_i);
+                        const int *N_v = nbrs_of(block_of(v_i), v_i);
+                        int d_u = deg[u_i];
+                        int d_v = deg[v_i];
+                        double dd_u = (double)d_u;
+                        double dd_v = (double)d_v;
+                        double cn_i = 0., aa_i = 0., ra_i = 0.;
+                        for (int p = 0, q = 0; p < d_u && q < d_v;) {
+                            if (N_u[p] < N_v[q]) ++p;
+                            else if (N_u[p] > N_v[q]) ++q;
+                            else {
+                                double dd_x = (double)deg[N_u[p]];
+                                cn_i += 1;
+                                aa_i += 1 / log(dd_x);
+                                ra_i += 1 / dd_x;
+                                ++p, ++q;
+                            }
+                        }
+                        double *r = res.data() + (size_t)t * n_metrics;
+                        r[0] = cn_i;
+                        r[1] = cn_i / sqrt(dd_u * dd_v);
+                        r[2] = cn_i / (dd_u + dd_v - cn_i);
+                        r[3] = cn_i / min(dd_u, dd_v);
+                        r[4] = cn_i / max(dd_u, dd_v);
+                        r[5] = cn_i / (dd_u + dd_v);
+                        r[6] = cn_i / (dd_u * dd_v);
+                        r[7] = aa_i;
+                        r[8] = ra_i;
+                        r[9] = dd_u * dd_v;
+                        r[10] = cn_i + fm[t];
+                        r[11] = dd_u + dd_v - 2;
+                    }
+                });
+                for (int t = 0; t < c; ++t) {
+                    fres.seekp(sizeof(double) * n_metrics * (long long)chunk[t].i);
+                    fres.write((const char *)(res.data() + (size_t)t * n_metrics), sizeof(double) * n_metrics);
+                }
+            }
+        }
+    }
+    cout << endl;
+    fadj.close();
+    fres.close();
+
+    // stream the per-edge results into the usual text files
+    ifstream fres_in(res_file.c_str(), ios::binary);
+    vector<ofstream> fout(n_metrics);
+    for (int j = 0; j < n_metrics; ++j) {
+        string outfile = "data/metrics_cpp/" + dataset_full + "_" + metric_names[j] + ".txt";
+        fout[j].open(outfile.c_str());
+    }
+    double row[n_metrics];
+    for (auto i = 0; i < m; ++i) {
+        fres_in.read((char *)row, sizeof(row));
+        for (int j = 0; j < n_metrics; ++j) {
+            fout[j] << row[j] << '\n';
+        }
+    }
+    for (auto &f : fout) f.close();
+    fres_in.close();
+    for (int b = 0; b < k; ++b) {
+        std::filesystem::remove(bucket_file(b));
+        std::filesystem::remove(fm_file(b));
+    }
+    std::filesystem::remove(res_file);
+    return 0;
+}
@@ -0,0 +1,407 @@
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+
+using namespace std;
+mutex mut_m, mut_n;
+
+// PEAR (the "# PEAR" cell of 2-experiments.ipynb) for many seeds and (a, k) parameters in one run
+// the CN buckets of the input graph (the edges grouped by their number of CNs), which layer 2 of every variant
+// samples from, are computed once; the variants then run concurrently, one per thread at a time
+// the random numbers are counter-based: the r-th number drawn for bucket c of layer l under seed s is a hash of
+// (s, l, c, r), so the outputs do not depend on the number of threads or on the order in which the variants run
+// (the variants with the same seed share their random numbers, which makes the parameter sweeps less noisy)
+// usage: ./pear_batch <dataset> [--seeds 1,2,3 | --seeds 1-100] [--ak a:k,a:k,...] [--max-layer l]
+// by default, seeds 1, 2 and 3 and the (a, k) of the dataset (g2fitting and i2ak of the notebook), layers 2 to 5
+// the layer l of each variant is written to data/pear_cpp/<name>-a<a>-k<k>-seed<s>.G_<l> ("u v" per line)
+// (a and k are written as Python writes floats, e.g. -a1.0-k1.1, the names the notebook reads)
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(start, end) :
+/// your function processing a sub chunk of the for loop.
+/// "start" is the first index to process (included) until the index "end"
+/// (excluded)
+/// @code
+///     for(int i = start; i < end; ++i)
+///         computation(i);
+/// @endcode
+/// @param use_threads : enable / disable threads.
+///
+///
+static void parallel_for(unsigned nb_elements,
+                         function<void(int start, int end)> functor,
+                         bool use_threads = true) {
+    // -------
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+
+    unsigned batch_size = nb_elements / nb_threads;
+    unsigned batch_remainder = nb_elements % nb_threads;
+
+    vector<thread> my_threads(nb_threads);
+
+    if (use_threads) {
+        // Multithread execution
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            my_threads[i] = std::thread(functor, start, start + batch_size);
+        }
+    } else {
+        // Single thread execution (for easy debugging)
+        for (unsigned i = 0; i < nb_threads; ++i) {
+            int start = i * batch_size;
+            functor(start, start + batch_size);
+        }
+    }
+
+    // Deform the elements left
+    int start = nb_threads * batch_size;
+    functor(start, start + batch_remainder);
+
+    // Wait for the other thread to finish their task
+    if (use_threads)
+        std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+/// @param[in] nb_elements : size of your for loop
+/// @param[in] functor(i) : your function processing the element i.
+/// each thread takes the next unprocessed element when done with its previous one,
+/// so that with the elements ordered by decreasing cost, the expensive ones start first
+/// and the threads finish at about the same time
+static void parallel_for_dynamic(unsigned nb_elements, function<void(int i)> functor) {
+    unsigned nb_threads_hint = thread::hardware_concurrency();
+    unsigned nb_threads = nb_threads_hint == 0 ? 8 : (nb_threads_hint);
+    atomic<unsigned> next(0);
+    vector<thread> my_threads(nb_threads);
+    for (unsigned t = 0; t < nb_threads; ++t) {
+        my_threads[t] = std::thread([&]() {
+            for (unsigned i = next++; i < nb_elements; i = next++) functor(i);
+        });
+    }
+    std::for_each(my_threads.begin(), my_threads.end(), std::mem_fn(&std::thread::join));
+}
+
+// reads "u v" (an optional weight column is skipped)
+static bool read_edge(ifstream &fin, int &u, int &v) {
+    if (!(fin >> u >> v)) return false;
+    fin.ignore(numeric_limits<streamsize>::max(), '\n');
+    return true;
+}
+
+// splitmix64 finalizer
+static uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// the r-th random number of the stream (seed, layer, bucket)
+static uint64_t counter_rng(uint64_t seed, uint64_t layer, uint64_t bucket, uint64_t r) {
+    return mix(mix(mix(mix(seed) ^ layer) ^ bucket) ^ r);
+}
+
+static double to_unit(uint64_t x) { return (double)(x >> 11) * 0x1.0p-53; }
+
+// uniform in [0, bound)
+static uint64_t to_range(uint64_t x, uint64_t bound) { return (uint64_t)(((unsigned __int128)x * bound) >> 64); }
+
+// the edges of a graph grouped by their number of CNs, and the number of node pairs sharing each number of CNs
+struct CNBuckets {
+    map<int, vector<pair<int, int>>> cn2e;
+    map<int, long long> cn2p;
+};
+
+// sorted neighbor lists of the given edges
+static vector<vector<int>> neighbor_lists(int n, const vector<pair<int, int>> &edges) {
+    vector<vector<int>> v2Nv(n);
+    for (auto &[u, v] : edges) {
+        v2Nv[u].push_back(v);
+        v2Nv[v].push_back(u);
+    }
+    for (auto &N : v2Nv) sort(N.begin(), N.end());
+    return v2Nv;
+}
+
+// the CN buckets of a sampled layer over all the pairs of its nodes (the nodes with an edge), as in the notebook;
+// the pairs with CNs are found through their wedges, and the others are counted as the remaining pairs
+static CNBuckets layer_buckets(int n, const vector<pair<int, int>> &edges, vector<int> &cnt, vector<int> &touched) {
+    CNBuckets res;
+    auto v2Nv = neighbor_lists(n, edges);
+    long long n_nodes = 0, pairs_with_cn = 0;
+    for (int u = 0; u < n; ++u) {
+        if (v2Nv[u].empty()) continue;
+        ++n_nodes;
+        for (auto x : v2Nv[u]) {
+            for (auto y : v2Nv[x]) {
+                if (y <= u) continue;
+                if (cnt[y]++ == 0) touched.push_back(y);
+            }
+        }
+        for (auto y : touched) {
+            ++res.cn2p[cnt[y]];
+            ++pairs_with_cn;
+        }
+        for (auto v : v2Nv[u]) {
+            if (v > u) res.cn2e[cnt[v]].emplace_back(u, v);
+        }
+        for (auto y : touched) cnt[y] = 0;
+        touched.clear();
+    }
+    long long pairs_without_cn = n_nodes * (n_nodes - 1) / 2 - pairs_with_cn;
+    if (pairs_without_cn > 0) res.cn2p[0] = pairs_without_cn;
+    return res;
+}
+
+// the largest |solve_se(se_root)| accepted; the notebook prints it as the "numerical difference"
+const double se_residual_tolerance = 1e-6;
+
+// the number of strong edges: the root of solve_se of the notebook, by Newton's method from 0.1 m like fsolve
+// residual: solve_se of the notebook at the returned value
+static double solve_se(double a, double k, double m, const CNBuckets &buckets, double tilde_c_star, double &residual) {
+    double rhs_sub = 0., rhs_den = 0.;
+    for (auto &[c, e_c] : buckets.cn2e) {
+        double m_c = (double)e_c.size();
+        rhs_sub += m_c * min(1., c / tilde_c_star);
+        if (c <= tilde_c_star) rhs_den += m_c * (tilde_c_star - c) / tilde_c_star;
+    }
+    auto f = [&](double se) { return a * pow(se / m, k) - (se - rhs_sub) / rhs_den; };
+    auto df = [&](double se) { return a * k * pow(se / m, k - 1) / m - 1 / rhs_den; };
+    double se = 0.1 * m;
+    for (int it = 0; it < 100; ++it) {
+        double step = f(se) / df(se);
+        double next = max(se - step, se / 2);
+        if (fabs(next - se) <= 1e-12 * m) {
+            se = next;
+            break;
+        }
+        se = next;
+    }
+    residual = f(se);
+    return se;
+}
+
+// samples the strong edges of each bucket (the next layer), as the sampling of the notebook
+// residual: see solve_se
+static vector<pair<int, int>> sample_layer(const CNBuckets &buckets, double a, double k, double tilde_c_star,
+                                           uint64_t seed, int layer, vector<int> &perm, double &residual) {
+    double m = 0.;
+    for (auto &[c, e_c] : buckets.cn2e) m += (double)e_c.size();
+    double se_root = solve_se(a, k, m, buckets, tilde_c_star, residual);
+    double p0 = a * pow(se_root / m, k);
+    vector<pair<int, int>> sampled;
+    for (auto &[c, e_c] : buckets.cn2e) {
+        double p_c = c ? min(1., p0 + (1 - p0) * c / tilde_c_star) : p0;
+        double M_c = (double)e_c.size() * p_c;
+        long long M_c_int = (long long)floor(M_c);
+        // draw 0 rounds M_c, draws 1, 2, ... pick the edges (partial Fisher-Yates)
+        if (to_unit(counter_rng(seed, layer, c, 0)) <= M_c - (double)M_c_int) ++M_c_int;
+        long long len = (long long)e_c.size();
+        M_c_int = min(M_c_int, len);
+        perm.resize(len);
+        iota(perm.begin(), perm.end(), 0);
+        for (long long j = 0; j < M_c_int; ++j) {
+            long long t = j + (long long)to_range(counter_rng(seed, layer, c, j + 1), len - j);
+            swap(perm[j], perm[t]);
+            sampled.push_back(e_c[perm[j]]);
+        }
+    }
+    sort(sampled.begin(), sampled.end());
+    return sampled;
+}
+
+// ints separated by ',', or a range "lo-hi"
+static vector<long long> parse_seeds(const string &arg) {
+    vector<long long> seeds;
+    long long lo, hi;
+    char dash;
+    istringstream range(arg);
+    if (arg.find('-') != string::npos && (range >> lo >> dash >> hi) && dash == '-') {
+        for (long long s = lo; s <= hi; ++s) seeds.push_back(s);
+        return seeds;
+    }
+    istringstream iss(arg);
+    string token;
+    while (getline(iss, token, ',')) seeds.push_back(atoll(token.c_str()));
+    return seeds;
+}
+
+// x as Python's str(float) writes it (0.9, 1.0, 1e-05), so that the file names are those the notebook reads
+static string py_float(double x) {
+    char buf[32];
+    string res(buf, to_chars(buf, buf + sizeof(buf), x).ptr);
+    if (res.find_first_of(".en") == string::npos) res += ".0";
+    return res;
+}
+
+// "a:k" pairs separated by ','
+static vector<pair<double, double>> parse_ak(const string &arg) {
+    vector<pair<double, double>> aks;
+    istringstream iss(arg);
+    string token;
+    while (getline(iss, token, ',')) {
+        auto colon = token.find(':');
+        if (colon == string::npos) throw invalid_argument("bad (a, k): " + token);
+        aks.emplace_back(atof(token.substr(0, colon).c_str()), atof(token.substr(colon + 1).c_str()));
+    }
+    return aks;
+}
+
+int main(int argc, char *argv[]) {
+    std::filesystem::create_directories("data/pear_cpp");
+    string dataset(argv[1]);
+    string dataset_full;
+    int n, m, fitting, gt_c_star_wt1;
+    if (dataset == "OF") {
+        dataset_full = "OF";
+        n = 987, m = 71380, fitting = 1, gt_c_star_wt1 = 241;
+    } else if (dataset == "FL") {
+        dataset_full = "openflights";
+        n = 2905, m = 15645, fitting = 2, gt_c_star_wt1 = 64;
+    } else if (dataset == "th-UB") {
+        dataset_full = "threads-ask-ubuntu-proj-graph";
+        n = 82075, m = 182648, fitting = 1, gt_c_star_wt1 = 73;
+    } else if (dataset == "th-MA") {
+        dataset_full = "threads-math-sx-proj-graph";
+        n = 152702, m = 1088735, fitting = 1, gt_c_star_wt1 = 372;
+    } else if (dataset == "th-SO") {
+        dataset_full = "threads-stack-overflow-proj-graph";
+        n = 2301070, m = 20989078, fitting = 1, gt_c_star_wt1 = 685;
+    } else if (dataset == "sx-UB") {
+        dataset_full = "sx-askubuntu";
+        n = 152599, m = 453221, fitting = 2, gt_c_star_wt1 = 152;
+    } else if (dataset == "sx-MA") {
+        dataset_full = "sx-mathoverflow";
+        n = 24668, m = 187939, fitting = 2, gt_c_star_wt1 = 185;
+    } else if (dataset == "sx-SO") {
+        dataset_full = "sx-stackoverflow";
+        n = 2572345, m = 28177464, fitting = 2, gt_c_star_wt1 = 886;
+    } else if (dataset == "sx-SU") {
+        dataset_full = "sx-superuser";
+        n = 189191, m = 712870, fitting = 2, gt_c_star_wt1 = 202;
+    } else if (dataset == "co-DB") {
+        dataset_full = "coauth-DBLP-proj-graph";
+        n = 1654109, m = 7713116, fitting = 3, gt_c_star_wt1 = 83;
+    } else if (dataset == "co-GE") {
+        dataset_full = "coauth-MAG-Geology-proj-graph";
+        n = 898648, m = 4891112, fitting = 3, gt_c_star_wt1 = 74;
+    } else {
+        throw invalid_argument("unknown dataset");
+    }
+    // i2ak of the notebook
+    const map<int, pair<double, double>> i2ak = {{1, {0.7, 1.3}}, {2, {0.9, 1.1}}, {3, {0.98, 1.02}}};
+    vector<long long> seeds = {1, 2, 3};
+    vector<pair<double, double>> aks = {i2ak.at(fitting)};
+    int max_layer = 5;
+    for (int a = 2; a < argc; ++a) {
+        string arg(argv[a]);
+        if (arg == "--seeds" && a + 1 < argc) seeds = parse_seeds(argv[++a]);
+        else if (arg == "--ak" && a + 1 < argc) aks = parse_ak(argv[++a]);
+        else if (arg == "--max-layer" && a + 1 < argc) max_layer = atoi(argv[++a]);
+        else throw invalid_argument("unknown option " + arg);
+    }
+
+    string edge_input = "data/edge_txt/" + dataset_full + ".edge_txt";
+    ifstream fin;
+    vector<pair<int, int>> edges;
+    edges.reserve(m);
+    fin.open(edge_input.c_str());
+    int u, v;
+    for (auto i = 0; i < m && read_edge(fin, u, v); ++i) {
+        edges.emplace_back(min(u, v), max(u, v));
+    }
+    fin.close();
+
+    // layer 2 samples the edges of the input graph by their CNs, whatever the seed and (a, k)
+    auto t0 = chrono::steady_clock::now();
+    CNBuckets base;
+    {
+        auto v2Nv = neighbor_lists(n, edges);
+        vector<int> cn(edges.size());
+        parallel_for(edges.size(), [&](int start, int end) {
+            vector<int> intersect;
+            for (auto i = start; i < end; ++i) {
+                auto &N_u = v2Nv[edges[i].first];
+                auto &N_v = v2Nv[edges[i].second];
+                intersect.clear();
+                set_intersection(N_u.begin(), N_u.end(), N_v.begin(), N_v.end(), back_inserter(intersect));
+                cn[i] = (int)intersect.size();
+            }
+        });
+        for (size_t i = 0; i < edges.size(); ++i) base.cn2e[cn[i]].push_back(edges[i]);
+    }
+    cout << "CN buckets: " << base.cn2e.size() << " buckets, "
+         << chrono::duration<double>(chrono::steady_clock::now() - t0).count() << " s" << endl;
+
+    vector<pair<long long, pair<double, double>>> variants;
+    for (auto &ak : aks) {
+        for (auto seed : seeds) variants.emplace_back(seed, ak);
+    }
+    int variant_count = 0;
+    parallel_for_dynamic(variants.size(), [&](int t) {
+        auto [seed, ak] = variants[t];
+        auto [a, k] = ak;
+        ostringstream name;
+        name << "data/pear_cpp/" << dataset_full << "-a" << py_float(a) << "-k" << py_float(k) << "-seed" << seed;
+        vector<int> cnt(n, 0), touched, perm;
+        const CNBuckets *buckets = &base;
+        CNBuckets layer;
+        double tilde_c_star = gt_c_star_wt1;
+        for (int i_layer = 2; i_layer <= max_layer; ++i_layer) {
+            if (i_layer > 2) {
+                // tilde_c_star = min(c for c in cn2p if 0 < cn2p[c] == cn2m[c]); the layers stop when there is none
+                tilde_c_star = -1.;
+                for (auto &[c, e_c] : layer.cn2e) {
+                    if (!e_c.empty() && layer.cn2p[c] == (long long)e_c.size()) {
+                        tilde_c_star = c;
+                        break;
+                    }
+                }
+                if (tilde_c_star < 0) break;
+                buckets = &layer;
+            }
+            double residual;
+            auto sampled = sample_layer(*buckets, a, k, tilde_c_star, (uint64_t)seed, i_layer, perm, residual);
+            if (!(fabs(residual) <= se_residual_tolerance)) {
+                // no root found (e.g. no edge with at most tilde_c_star CNs); the layer is written as the notebook would
+                mut_n.lock();
+                cerr << endl << name.str() << ".G_" << i_layer << ": the number of strong edges did not converge"
+                     << " (numerical difference " << residual << ")" << endl;
+                mut_n.unlock();
+            }
+            ofstream fout((name.str() + ".G_" + to_string(i_layer)).c_str());
+            for (auto &[x, y] : sampled) fout << x << " " << y << "\n";
+            fout.close();
+            if (i_layer < max_layer) layer = layer_buckets(n, sampled, cnt, touched);
+        }
+        mut_n.lock();
+        cout << "\r" << ++variant_count << "/" << variants.size() << flush;
+        mut_n.unlock();
+    });
+    cout << endl << "written " << variants.size() << " variants to data/pear_cpp" << endl;
+    return 0;
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// the "--profile" mode of metrics.cpp, local_path.cpp, cn_pairs.cpp and bench.cpp: Linux perf_event_open counters
+// (cycles, instructions, cache and dTLB misses, branch mispredicts, plus task clock and page faults) for each phase
+// of a run, both in total (the counters of the main thread inherit those of the threads it starts) and per worker
+// (opened by each thread on its first call to thread_enter), written with wall times and the derived rates of the
+// program to a JSON report
+// a worker is a slot taken by a thread for its lifetime and released when it exits, so the successive pools of a
+// phase add into the same per-worker entries, and at most hardware_concurrency threads hold counters at a time
+// (the fds open at once stay bounded however many threads the pools start)
+// an event that cannot be opened (no PMU in a VM, perf_event_paranoid, seccomp) is left out of the report,
+// and without any event the report still has the wall times and the derived rates
+class Profiler {
+public:
+    struct Event {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+    };
+
+    static const std::vector<Event> &events() {
+        static const std::vector<Event> list = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"cache_references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+            {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"dtlb_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+            {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+            {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        };
+        return list;
+    }
+
+    explicit Profiler(bool enabled) : enabled(enabled) {
+        if (!enabled) return;
+        main_thread = std::this_thread::get_id();
+        main_fds = open_counters(true, &error, {});
+        for (size_t e = 0; e < main_fds.size(); ++e) {
+            available |= main_fds[e] >= 0;
+            hw_available |= main_fds[e] >= 0 && events()[e].type != PERF_TYPE_SOFTWARE;
+        }
+        unsigned hint = std::thread::hardware_concurrency();
+        worker_busy.assign(hint == 0 ? 8 : hint, false);
+        if (!available) std::cout << "profile: no counters available (" << error << "), wall times only" << std::endl;
+        else if (!hw_available) std::cout << "profile: no hardware counters available (" << error << "), software counters only" << std::endl;
+        last = read_counters(main_fds);
+        t_last = std::chrono::steady_clock::now();
+        instance() = this;
+    }
+
+    ~Profiler() {
+        for (auto fd : main_fds) {
+            if (fd >= 0) close(fd);
+        }
+        if (instance() == this) instance() = nullptr;
+    }
+
+    // ends the current phase (if any) and starts the next one
+    void phase(const std::string &name) {
+        if (!enabled) return;
+        end_phase();
+        std::lock_guard<std::mutex> lock(mut);
+        phases.push_back({name, 0., {}, std::vector<std::map<std::string, double>>(worker_busy.size())});
+        current = (int)phases.size() - 1;
+    }
+
+    void finish() {
+        if (!enabled) return;
+        end_phase();
+        current = -1;
+    }
+
+    // to call from the worker threads of a phase; only the first call of a thread takes a free worker slot and
+    // opens its counters (the events the main thread could open), which are read when the thread exits
+    // a thread finding no free slot is left out of the per-worker counters (it still counts in the totals)
+    static void thread_enter() {
+        Profiler *prof = instance();
+        if (!prof || !prof->available || std::this_thread::get_id() == prof->main_thread) return;
+        thread_local ThreadCounters counters;
+        if (counters.owner) return;
+        {
+            std::lock_guard<std::mutex> lock(prof->mut);
+            auto it = std::find(prof->worker_busy.begin(), prof->worker_busy.end(), false);
+            if (it == prof->worker_busy.end()) return;
+            *it = true;
+            counters.worker = (int)(it - prof->worker_busy.begin());
+        }
+        counters.owner = prof;
+        counters.phase = prof->current;
+        counters.fds = open_counters(false, nullptr, prof->main_fds);
+        counters.start = read_counters(counters.fds);
+    }
+
+    double seconds(const std::string &name) const {
+        for (auto &p : phases) {
+            if (p.name == name) return p.seconds;
+        }
+        return 0.;
+    }
+
+    // the counter of a phase, or -1 when not available
+    double counter(const std::string &name, const std::string &event) const {
+        for (auto &p : phases) {
+            if (p.name != name) continue;
+            auto it = p.totals.find(event);
+            return it == p.totals.end() ? -1. : it->second;
+        }
+        return -1.;
+    }
+
+    // derived: the rates computed by the program (items per second, bytes of adjacency per item, ...)
+    void write_json(const std::string &file, const std::string &program, const std::string &dataset,
+                    const std::vector<std::pair<std::string, double>> &derived) const {
+        if (!enabled) return;
+        std::ofstream fout(file.c_str());
+        fout << "{\n";
+        fout << "  \"program\": " << json_string(program) << ",\n";
+        fout << "  \"dataset\": " << json_string(dataset) << ",\n";
+        fout << "  \"threads\": " << std::thread::hardware_concurrency() << ",\n";
+        // any counter, and the hardware ones (cycles, instructions, cache, dTLB and branch misses) apart,
+        // as the software ones (task clock, page faults) still open without a PMU
+        fout << "  \"counters_available\": " << (available ? "true" : "false") << ",\n";
+        fout << "  \"hw_counters_available\": " << (hw_available ? "true" : "false") << ",\n";
+        if (!error.empty()) {
+            // the first failure, and every event left out
+            fout << "  \"counters_error\": " << json_string(error) << ",\n  \"counters_unavailable\": [";
+            bool first = true;
+            for (size_t e = 0; e < main_fds.size(); ++e) {
+                if (main_fds[e] >= 0) continue;
+                fout << (first ? "" : ", ") << json_string(events()[e].name);
+                first = false;
+            }
+            fout << "],\n";
+        }
+        fout << "  \"phases\": [\n";
+        for (size_t i = 0; i < phases.size(); ++i) {
+            auto &p = phases[i];
+            fout << "    {\n      \"name\": " << json_string(p.name) << ",\n      \"seconds\": " << p.seconds << ",\n";
+            fout << "      \"counters\": ";
+            write_counters(fout, p.totals, true);
+            // the workers that ran in the phase
+            fout << ",\n      \"per_worker\": [";
+            bool first = true;
+            for (auto &w : p.per_worker) {
+                if (w.empty()) continue;
+                fout << (first ? "\n        " : ",\n        ");
+                write_counters(fout, w, false);
+                first = false;
+            }
+            fout << (first ? "]" : "\n      ]") << "\n    }" << (i + 1 < phases.size() ? "," : "") << "\n";
+        }
+        fout << "  ],\n  \"derived\": {";
+        for (size_t i = 0; i < derived.size(); ++i) {
+            fout << (i ? ",\n" : "\n") << "    " << json_string(derived[i].first) << ": " << json_number(derived[i].second);
+        }
+        fout << (derived.empty() ? "}" : "\n  }") << "\n}\n";
+        fout.close();
+        std::cout << "profile written to " << file << std::endl;
+    }
+
+private:
+    struct Phase {
+        std::string name;
+        double seconds;
+        std::map<std::string, double> totals;
+        // indexed by worker slot, the counters of its threads summed
+        std::vector<std::map<std::string, double>> per_worker;
+    };
+
+    struct ThreadCounters {
+        Profiler *owner = nullptr;
+        int phase = -1, worker = -1;
+        std::vector<int> fds;
+        std::vector<double> start;
+
+        ~ThreadCounters() {
+            if (!owner) return;
+            auto end = read_counters(fds);
+            std::map<std::string, double> values;
+            for (size_t e = 0; e < fds.size(); ++e) {
+                if (fds[e] >= 0) values[events()[e].name] = end[e] - start[e];
+                if (fds[e] >= 0) close(fds[e]);
+            }
+            // the profiler may be gone if the thread outlives it
+            Profiler *prof = instance();
+            if (prof != owner) return;
+            std::lock_guard<std::mutex> lock(prof->mut);
+            prof->worker_busy[worker] = false;
+            if (phase < 0) return;
+            for (auto &[name, value] : values) prof->phases[phase].per_worker[worker][name] += value;
+        }
+    };
+
+    static Profiler *&instance() {
+        static Profiler *prof = nullptr;
+        return prof;
+    }
+
+    // the counters of the calling thread (user space only, which perf_event_paranoid = 2 still allows)
+    // only: when not empty, the events to open are those with only[e] >= 0
+    static std::vector<int> open_counters(bool inherit, std::string *first_error, const std::vector<int> &only) {
+        std::vector<int> fds;
+        for (size_t e = 0; e < events().size(); ++e) {
+            auto &ev = events()[e];
+            if (!only.empty() && only[e] < 0) {
+                fds.push_back(-1);
+                continue;
+            }
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = ev.type;
+            attr.config = ev.config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.inherit = inherit ? 1 : 0;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd < 0 && first_error && first_error->empty()) *first_error = ev.name + std::string(": ") + strerror(errno);
+            fds.push_back(fd);
+        }
+        return fds;
+    }
+
+    // scaled by the fraction of the time the event was counted (the PMU multiplexes when there are too many)
+    static std::vector<double> read_counters(const std::vector<int> &fds) {
+        std::vector<double> values(fds.size(), 0.);
+        for (size_t e = 0; e < fds.size(); ++e) {
+            uint64_t buf[3];
+            if (fds[e] < 0 || read(fds[e], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) continue;
+            values[e] = buf[2] ? (double)buf[0] * ((double)buf[1] / (double)buf[2]) : 0.;
+        }
+        return values;
+    }
+
+    void end_phase() {
+        auto now = read_counters(main_fds);
+        auto t_now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mut);
+        if (current >= 0) {
+            auto &p = phases[current];
+            p.seconds = std::chrono::duration<double>(t_now - t_last).count();
+            for (size_t e = 0; e < main_fds.size(); ++e) {
+                if (main_fds[e] >= 0) p.totals[events()[e].name] = now[e] - last[e];
+            }
+        }
+        last = now;
+        t_last = t_now;
+    }
+
+    // quoted, with '"', '\\' and the control characters escaped
+    static std::string json_string(const std::string &str) {
+        std::string res = "\"";
+        for (unsigned char c : str) {
+            if (c == '"' || c == '\\') {
+                res += '\\';
+                res += (char)c;
+            } else if (c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                res += buf;
+            } else {
+                res += (char)c;
+            }
+        }
+        return res + "\"";
+    }
+
+    static std::string json_number(double x) {
+        if (!std::isfinite(x)) return "null";
+        std::ostringstream oss;
+        oss.precision(10);
+        oss << x;
+        return oss.str();
+    }
+
+    // the counters, and with ratios the IPC and the misses per thousand instructions
+    static void write_counters(std::ofstream &fout, const std::map<std::string, double> &values, bool ratios) {
+        std::vector<std::pair<std::string, double>> fields(values.begin(), values.end());
+        auto get = [&](const char *name) {
+            auto it = values.find(name);
+            return it == values.end() ? -1. : it->second;
+        };
+        double instructions = get("instructions");
+        if (ratios && instructions > 0) {
+            if (get("cycles") > 0) fields.emplace_back("ipc", instructions / get("cycles"));
+            for (auto name : {"cache_misses", "dtlb_misses", "branch_misses"}) {
+                if (get(name) >= 0) fields.emplace_back(std::string(name) + "_per_kilo_instruction", get(name) * 1000. / instructions);
+            }
+        }
+        fout << "{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            fout << (i ? ", " : "") << json_string(fields[i].first) << ": " << json_number(fields[i].second);
+        }
+        fout << "}";
+    }
+
+    bool enabled, available = false, hw_available = false;
+    std::string error;
+    std::thread::id main_thread;
+    std::vector<int> main_fds;
+    std::vector<double> last;
+    std::chrono::steady_clock::time_point t_last;
+    std::mutex mut;
+    std::vector<bool> worker_busy;
+    std::vector<Phase> phases;
+    int current = -1;
+};
@@ -0,0 +1,18 @@
+# builds the graph_kernels extension (graph_kernels.cpp) in place:
+#     python setup.py build_ext --inplace
+import numpy as np
+from setuptools import Extension, setup
+
+setup(
+    name="graph_kernels",
+    ext_modules=[
+        Extension(
+            "graph_kernels",
+            sources=["graph_kernels.cpp"],
+            include_dirs=[np.get_include()],
+            extra_compile_args=["-O3", "-std=c++2a"],
+            extra_link_args=["-lpthread"],
+            language="c++",
+        )
+    ],
+)